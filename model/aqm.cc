@@ -0,0 +1,286 @@
+#include "aqm.h"
+#include "ns3/log.h"
+#include "ns3/object.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("Aqm");
+
+Aqm::Aqm() : m_ecn(false) {
+}
+
+Aqm::~Aqm() {
+}
+
+/**
+ * @brief Chooses between marking ECN-capable packets and dropping them.
+ *
+ * @param ecn True to mark Congestion Experienced instead of dropping.
+ */
+void Aqm::SetEcn(bool ecn) {
+    m_ecn = ecn;
+}
+
+bool Aqm::GetEcn() const {
+    return m_ecn;
+}
+
+Aqm::Verdict Aqm::OnEnqueue(uint32_t packets, uint64_t bytes, Time now) {
+    return ACCEPT;
+}
+
+Aqm::Verdict Aqm::OnDequeue(Time sojourn, uint64_t bytes, Time now) {
+    return ACCEPT;
+}
+
+/**
+ * @brief Returns the verdict for a packet the policy chose to signal congestion on.
+ */
+Aqm::Verdict Aqm::Congested() const {
+    return m_ecn ? MARK : DROP;
+}
+
+CoDel::CoDel(Time target, Time interval)
+    : m_target(target), m_interval(interval), m_count(0), m_lastCount(0), m_dropping(false) {
+}
+
+std::string CoDel::GetName() const {
+    return "CoDel";
+}
+
+/**
+ * @brief Runs the CoDel state machine for one departing packet.
+ *
+ * Enters the dropping state once the sojourn time has stayed above target for a whole
+ * interval, then signals one packet per ControlLaw() step until it falls below target.
+ * On re-entry shortly after leaving, the drop rate resumes near where it was.
+ */
+Aqm::Verdict CoDel::OnDequeue(Time sojourn, uint64_t bytes, Time now) {
+    bool okToDrop = OkToDrop(sojourn, bytes, now);
+    if (m_dropping) {
+        if (!okToDrop) {
+            m_dropping = false;
+            NS_LOG_LOGIC("CoDel: left dropping state, count=" << m_count);
+            return ACCEPT;
+        }
+        if (now >= m_dropNext) {
+            m_count++;
+            m_dropNext = ControlLaw(m_dropNext);
+            return Congested();
+        }
+        return ACCEPT;
+    }
+    if (okToDrop) {
+        m_dropping = true;
+        uint32_t delta = m_count - m_lastCount;
+        m_count = (delta > 1 && now - m_dropNext < m_interval * 16) ? delta : 1;
+        m_lastCount = m_count;
+        m_dropNext = ControlLaw(now);
+        NS_LOG_LOGIC("CoDel: entered dropping state, sojourn=" << sojourn.GetSeconds() << "s, count=" << m_count);
+        return Congested();
+    }
+    return ACCEPT;
+}
+
+/**
+ * @brief Tells whether the sojourn time has been above target for at least an interval.
+ *
+ * A queue holding at most one MTU is never considered congested.
+ */
+bool CoDel::OkToDrop(Time sojourn, uint64_t bytes, Time now) {
+    if (sojourn < m_target || bytes <= MTU) {
+        m_firstAboveTime = Seconds(0);
+        return false;
+    }
+    if (m_firstAboveTime.IsZero()) {
+        m_firstAboveTime = now + m_interval;
+        return false;
+    }
+    return now >= m_firstAboveTime;
+}
+
+Time CoDel::ControlLaw(Time t) const {
+    return t + NanoSeconds(static_cast<uint64_t>(m_interval.GetNanoSeconds() / std::sqrt(m_count)));
+}
+
+Pie::Pie(Time target, Time update)
+    : m_target(target), m_update(update), m_maxBurst(MilliSeconds(150)), m_alpha(0.125), m_beta(1.25),
+      m_probability(0), m_burstAllowance(MilliSeconds(150)) {
+    m_random = CreateObject<UniformRandomVariable>();
+}
+
+std::string Pie::GetName() const {
+    return "PIE";
+}
+
+/**
+ * @brief Drops or marks an arriving packet with the current drop probability.
+ *
+ * Nothing is dropped during the burst allowance, while the delay is well below target
+ * and the probability low, or while at most two MTUs are queued. Above a probability of
+ * 10% packets are dropped even when ECN is enabled.
+ */
+Aqm::Verdict Pie::OnEnqueue(uint32_t packets, uint64_t bytes, Time now) {
+    if (packets == 0) {
+        m_qdelay = Seconds(0);
+    }
+    UpdateProbability(now);
+    if (m_burstAllowance.IsStrictlyPositive()) {
+        return ACCEPT;
+    }
+    if ((m_qdelayOld < m_target / 2 && m_probability < 0.2) || bytes <= 2 * MTU) {
+        return ACCEPT;
+    }
+    if (m_random->GetValue() >= m_probability) {
+        return ACCEPT;
+    }
+    return m_probability <= 0.1 ? Congested() : DROP;
+}
+
+Aqm::Verdict Pie::OnDequeue(Time sojourn, uint64_t bytes, Time now) {
+    m_qdelay = sojourn;
+    UpdateProbability(now);
+    return ACCEPT;
+}
+
+/**
+ * @brief Replays the periodic probability updates due since the last one.
+ *
+ * The adjustment is scaled down while the probability is small, as in RFC 8033, and the
+ * probability decays when the queue stays empty. After a long idle period only the last
+ * MAX_CATCH_UP updates are replayed.
+ */
+void Pie::UpdateProbability(Time now) {
+    if (now - m_lastUpdate >= m_update * MAX_CATCH_UP) {
+        m_lastUpdate = now - m_update * MAX_CATCH_UP;
+    }
+    while (now - m_lastUpdate >= m_update) {
+        m_lastUpdate += m_update;
+        double delta = m_alpha * (m_qdelay - m_target).GetSeconds()
+                     + m_beta * (m_qdelay - m_qdelayOld).GetSeconds();
+        if (m_probability < 0.000001) {
+            delta /= 2048;
+        } else if (m_probability < 0.00001) {
+            delta /= 512;
+        } else if (m_probability < 0.0001) {
+            delta /= 128;
+        } else if (m_probability < 0.001) {
+            delta /= 32;
+        } else if (m_probability < 0.01) {
+            delta /= 8;
+        } else if (m_probability < 0.1) {
+            delta /= 2;
+        } else if (delta > 0.02) {
+            delta = 0.02;
+        }
+        m_probability = std::clamp(m_probability + delta, 0.0, 1.0);
+        if (m_qdelay.IsZero() && m_qdelayOld.IsZero()) {
+            m_probability *= 0.98;
+        }
+        m_burstAllowance = m_burstAllowance > m_update ? m_burstAllowance - m_update : Seconds(0);
+        if (m_probability == 0 && m_qdelay < m_target / 2 && m_qdelayOld < m_target / 2) {
+            m_burstAllowance = m_maxBurst;
+        }
+        m_qdelayOld = m_qdelay;
+    }
+}
+
+Red::Red(double minThreshold, double maxThreshold, double maxProbability, double weight)
+    : m_minThreshold(minThreshold), m_maxThreshold(maxThreshold), m_maxProbability(maxProbability),
+      m_weight(weight), m_average(0), m_count(0) {
+    m_random = CreateObject<UniformRandomVariable>();
+}
+
+std::string Red::GetName() const {
+    return "RED";
+}
+
+/**
+ * @brief Updates the average queue length and drops or marks the arrival accordingly.
+ *
+ * Between the thresholds the drop probability grows with the packets accepted since the
+ * last drop, which spaces drops out evenly. Above the upper threshold every packet is
+ * dropped, even when ECN is enabled.
+ */
+Aqm::Verdict Red::OnEnqueue(uint32_t packets, uint64_t bytes, Time now) {
+    m_average = (1 - m_weight) * m_average + m_weight * packets;
+    if (m_average < m_minThreshold) {
+        m_count = 0;
+        return ACCEPT;
+    }
+    if (m_average >= m_maxThreshold) {
+        m_count = 0;
+        return DROP;
+    }
+    double pb = m_maxProbability * (m_average - m_minThreshold) / (m_maxThreshold - m_minThreshold);
+    double pa = m_count * pb >= 1 ? 1 : pb / (1 - m_count * pb);
+    m_count++;
+    if (m_random->GetValue() < pa) {
+        m_count = 0;
+        return Congested();
+    }
+    return ACCEPT;
+}
+
+/**
+ * @brief Creates an AQM policy from its config file description.
+ *
+ *     codel [targetMs] [intervalMs]
+ *     pie [targetMs] [updateMs]
+ *     red <minPackets> <maxPackets> [maxProbability] [weight]
+ *
+ * Times must be positive, RED thresholds must satisfy 0 <= min < max, and its maximum
+ * probability and averaging weight must lie in [0, 1], the weight above 0.
+ *
+ * @param type The policy name.
+ * @param params The numeric parameters that follow it.
+ * @param ecn True to mark ECN-capable packets instead of dropping them.
+ * @param error Set to what is wrong with the description when nullptr is returned.
+ * @return The new policy, or nullptr if the type is unknown or the parameters are invalid.
+ */
+Aqm* CreateAqm(const std::string& type, const std::vector<double>& params, bool ecn, std::string& error) {
+    auto param = [&params](size_t i, double fallback) { return i < params.size() ? params[i] : fallback; };
+    if (type != "codel" && type != "pie" && type != "red") {
+        error = "unknown AQM '" + type + "'";
+        return nullptr;
+    }
+    size_t minParams = type == "red" ? 2 : 0;
+    size_t maxParams = type == "red" ? 4 : 2;
+    if (params.size() < minParams || params.size() > maxParams) {
+        error = type + " takes " + std::to_string(minParams) + " to " + std::to_string(maxParams)
+                + " parameters, got " + std::to_string(params.size());
+        return nullptr;
+    }
+    Aqm* aqm;
+    if (type == "red") {
+        double minThreshold = params[0], maxThreshold = params[1];
+        double maxProbability = param(2, 0.1), weight = param(3, 0.002);
+        if (!(minThreshold >= 0 && minThreshold < maxThreshold) || !std::isfinite(maxThreshold)) {
+            error = "red thresholds must satisfy 0 <= min < max";
+            return nullptr;
+        }
+        if (!(maxProbability >= 0 && maxProbability <= 1) || !(weight > 0 && weight <= 1)) {
+            error = "red probability must be in [0, 1] and weight in (0, 1]";
+            return nullptr;
+        }
+        aqm = new Red(minThreshold, maxThreshold, maxProbability, weight);
+    } else {
+        double target = param(0, type == "codel" ? 5 : 15);
+        double interval = param(1, type == "codel" ? 100 : 15);
+        if (!(target > 0 && interval > 0) || !std::isfinite(target) || !std::isfinite(interval)) {
+            error = type + " times must be positive";
+            return nullptr;
+        }
+        if (type == "codel") {
+            aqm = new CoDel(MicroSeconds(target * 1000), MicroSeconds(interval * 1000));
+        } else {
+            aqm = new Pie(MicroSeconds(target * 1000), MicroSeconds(interval * 1000));
+        }
+    }
+    aqm->SetEcn(ecn);
+    return aqm;
+}
+
+} // namespace ns3
@@ -0,0 +1,139 @@
+#ifndef AQM_H
+#define AQM_H
+
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+#include "ns3/random-variable-stream.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * @brief Active queue management policy of a single TrafficClass.
+ *
+ * The class consults its policy when a packet arrives and when each head packet leaves;
+ * the policy answers whether to keep the packet, mark it Congestion Experienced, or drop
+ * it. Policies that mark fall back to dropping packets that are not ECN-capable.
+ */
+class Aqm {
+public:
+    enum Verdict {
+        ACCEPT,
+        MARK,
+        DROP
+    };
+
+    Aqm();
+    virtual ~Aqm();
+
+    void SetEcn(bool ecn);
+    bool GetEcn() const;
+    virtual std::string GetName() const = 0;
+
+    /**
+     * @brief Judges an arriving packet.
+     *
+     * @param packets Packets already queued in the class.
+     * @param bytes Bytes already queued in the class.
+     * @param now The current simulation time.
+     */
+    virtual Verdict OnEnqueue(uint32_t packets, uint64_t bytes, Time now);
+
+    /**
+     * @brief Judges the packet leaving the head of the queue.
+     *
+     * @param sojourn Time the packet spent in the queue.
+     * @param bytes Bytes still queued behind it.
+     * @param now The current simulation time.
+     */
+    virtual Verdict OnDequeue(Time sojourn, uint64_t bytes, Time now);
+
+protected:
+    Verdict Congested() const;
+
+    static constexpr uint32_t MTU = 1500;
+
+private:
+    bool m_ecn;
+};
+
+/**
+ * @brief CoDel (RFC 8289): drops at dequeue once the sojourn time stays above target for
+ * an interval, at a rate growing with the square root of the number of drops.
+ */
+class CoDel : public Aqm {
+public:
+    CoDel(Time target = MilliSeconds(5), Time interval = MilliSeconds(100));
+    std::string GetName() const override;
+    Verdict OnDequeue(Time sojourn, uint64_t bytes, Time now) override;
+
+private:
+    bool OkToDrop(Time sojourn, uint64_t bytes, Time now);
+    Time ControlLaw(Time t) const;
+
+    Time m_target;
+    Time m_interval;
+    Time m_firstAboveTime;   // zero while the sojourn time is below target
+    Time m_dropNext;
+    uint32_t m_count;
+    uint32_t m_lastCount;
+    bool m_dropping;
+};
+
+/**
+ * @brief PIE (RFC 8033): drops at enqueue with a probability steered every update
+ * interval by the queueing delay, measured here from the sojourn time of departing
+ * packets.
+ */
+class Pie : public Aqm {
+public:
+    Pie(Time target = MilliSeconds(15), Time update = MilliSeconds(15));
+    std::string GetName() const override;
+    Verdict OnEnqueue(uint32_t packets, uint64_t bytes, Time now) override;
+    Verdict OnDequeue(Time sojourn, uint64_t bytes, Time now) override;
+
+private:
+    void UpdateProbability(Time now);
+
+    static constexpr uint32_t MAX_CATCH_UP = 64;  // updates replayed after an idle period
+
+    Time m_target;
+    Time m_update;
+    Time m_maxBurst;
+    double m_alpha;
+    double m_beta;
+    double m_probability;
+    Time m_qdelay;
+    Time m_qdelayOld;
+    Time m_burstAllowance;
+    Time m_lastUpdate;
+    Ptr<UniformRandomVariable> m_random;
+};
+
+/**
+ * @brief RED: drops at enqueue with a probability rising linearly with the average queue
+ * length, in packets, between two thresholds, and always above the upper one.
+ */
+class Red : public Aqm {
+public:
+    Red(double minThreshold, double maxThreshold, double maxProbability = 0.1, double weight = 0.002);
+    std::string GetName() const override;
+    Verdict OnEnqueue(uint32_t packets, uint64_t bytes, Time now) override;
+
+private:
+    double m_minThreshold;
+    double m_maxThreshold;
+    double m_maxProbability;
+    double m_weight;
+    double m_average;
+    uint32_t m_count;        // packets since the last drop while between the thresholds
+    Ptr<UniformRandomVariable> m_random;
+};
+
+Aqm* CreateAqm(const std::string& type, const std::vector<double>& params, bool ecn, std::string& error);
+
+} // namespace ns3
+
+#endif /* AQM_H */
@@ -0,0 +1,509 @@
+#include "classifier-index.h"
+#include "traffic-class.h"
+#include <algorithm>
+#include <bitset>
+#include <set>
+
+namespace ns3 {
+
+namespace {
+
+/**
+ * @brief Ranks how well an element narrows down the set of candidate packets.
+ *
+ * The element with the highest score becomes the filter's anchor. A score of zero
+ * means the element cannot be indexed.
+ */
+uint32_t AnchorScore(const MatchSpec& spec) {
+    switch (spec.field) {
+    case MatchField::SrcAddress:
+    case MatchField::DstAddress: {
+        uint32_t inverted = ~spec.mask;
+        if ((inverted & (inverted + 1)) != 0) {
+            return 0; // non-contiguous mask
+        }
+        if (spec.mask == 0xffffffff) {
+            return 100;
+        }
+        return 50 + static_cast<uint32_t>(std::bitset<32>(spec.mask).count());
+    }
+    case MatchField::SrcAddress6:
+    case MatchField::DstAddress6:
+        return spec.mask == 128 ? 100 : 50 + spec.mask / 4;
+    case MatchField::SrcPort:
+    case MatchField::DstPort:
+        return spec.value == spec.high ? 90 : 40;
+    case MatchField::Dscp:
+        return 20;
+    case MatchField::Protocol:
+    case MatchField::NextHeader:
+        return 10;
+    default:
+        return 0;
+    }
+}
+
+inline uint32_t Bit128(const uint64_t a[2], uint32_t i) {
+    return i < 64 ? (a[0] >> (63 - i)) & 1 : (a[1] >> (127 - i)) & 1;
+}
+
+/**
+ * @brief Number of leading bits two 128-bit values have in common.
+ */
+inline uint32_t CommonLength128(const uint64_t a[2], const uint64_t b[2]) {
+    if (a[0] != b[0]) {
+        return __builtin_clzll(a[0] ^ b[0]);
+    }
+    if (a[1] != b[1]) {
+        return 64 + __builtin_clzll(a[1] ^ b[1]);
+    }
+    return 128;
+}
+
+inline void Mask128(const uint64_t a[2], uint32_t length, uint64_t out[2]) {
+    out[0] = length == 0 ? 0 : a[0] & (~0ULL << (64 - std::min(length, 64u)));
+    out[1] = length <= 64 ? 0 : a[1] & (~0ULL << (128 - length));
+}
+
+} // namespace
+
+ClassifierIndex::PrefixTrie::PrefixTrie() {
+    Clear();
+}
+
+void ClassifierIndex::PrefixTrie::Clear() {
+    m_nodes.assign(1, Node{{-1, -1}, RuleList()});
+}
+
+/**
+ * @brief Stores a rule at the node for the given prefix, creating the path as needed.
+ *
+ * @param value The prefix bits, already masked.
+ * @param prefixLength Number of leading bits that must match.
+ * @param rule The rule to store.
+ */
+void ClassifierIndex::PrefixTrie::Insert(uint32_t value, uint32_t prefixLength, const Rule& rule) {
+    int32_t node = 0;
+    for (uint32_t depth = 0; depth < prefixLength; ++depth) {
+        uint32_t bit = (value >> (31 - depth)) & 1;
+        if (m_nodes[node].child[bit] < 0) {
+            m_nodes[node].child[bit] = static_cast<int32_t>(m_nodes.size());
+            m_nodes.push_back(Node{{-1, -1}, RuleList()});
+        }
+        node = m_nodes[node].child[bit];
+    }
+    m_nodes[node].rules.push_back(rule);
+}
+
+/**
+ * @brief Walks the trie along the address and checks the rules of every matching prefix.
+ *
+ * @param address The packet address to look up.
+ * @param key The packet's flow key, used to verify multi-element filters.
+ * @param best Lowest matching class index found so far; lowered when a better match is found.
+ */
+void ClassifierIndex::PrefixTrie::Lookup(uint32_t address, const FlowKey& key, uint32_t& best) const {
+    int32_t node = 0;
+    for (uint32_t depth = 0; node >= 0 && best > 0; ++depth) {
+        ClassifierIndex::Scan(m_nodes[node].rules, key, best);
+        if (depth == 32) {
+            break;
+        }
+        node = m_nodes[node].child[(address >> (31 - depth)) & 1];
+    }
+}
+
+ClassifierIndex::CompressedTrie::CompressedTrie() {
+    Clear();
+}
+
+void ClassifierIndex::CompressedTrie::Clear() {
+    const uint64_t zero[2] = {0, 0};
+    m_nodes.clear();
+    NewNode(zero, 0);
+}
+
+int32_t ClassifierIndex::CompressedTrie::NewNode(const uint64_t value[2], uint32_t length) {
+    Node node{{0, 0}, length, {-1, -1}, RuleList()};
+    Mask128(value, length, node.prefix);
+    m_nodes.push_back(node);
+    return static_cast<int32_t>(m_nodes.size() - 1);
+}
+
+/**
+ * @brief Stores a rule at the node for the given prefix, splitting a compressed edge if
+ * the prefix ends or diverges inside it.
+ *
+ * @param value The prefix bits, already masked.
+ * @param prefixLength Number of leading bits that must match.
+ * @param rule The rule to store.
+ */
+void ClassifierIndex::CompressedTrie::Insert(const uint64_t value[2], uint32_t prefixLength, const Rule& rule) {
+    int32_t node = 0;
+    while (m_nodes[node].length < prefixLength) {
+        uint32_t bit = Bit128(value, m_nodes[node].length);
+        int32_t child = m_nodes[node].child[bit];
+        if (child < 0) {
+            int32_t leaf = NewNode(value, prefixLength);
+            m_nodes[node].child[bit] = leaf;
+            node = leaf;
+            break;
+        }
+        uint32_t common = std::min({prefixLength, m_nodes[child].length, CommonLength128(value, m_nodes[child].prefix)});
+        if (common == m_nodes[child].length) {
+            node = child;
+            continue;
+        }
+        // The prefix leaves the child's edge after common bits: insert a node there.
+        int32_t split = NewNode(value, common);
+        m_nodes[split].child[Bit128(m_nodes[child].prefix, common)] = child;
+        m_nodes[node].child[bit] = split;
+        node = split;
+    }
+    m_nodes[node].rules.push_back(rule);
+}
+
+/**
+ * @brief Walks the trie along the address and checks the rules of every matching prefix.
+ *
+ * Skipped edge bits are not compared on the way down, so each node's prefix is verified
+ * against the address before its rules are checked.
+ *
+ * @param address The packet address to look up.
+ * @param key The packet's flow key, used to verify multi-element filters.
+ * @param best Lowest matching class index found so far; lowered when a better match is found.
+ */
+void ClassifierIndex::CompressedTrie::Lookup(const uint64_t address[2], const FlowKey& key, uint32_t& best) const {
+    int32_t node = 0;
+    while (node >= 0 && best > 0) {
+        const Node& n = m_nodes[node];
+        if (CommonLength128(address, n.prefix) < n.length) {
+            break;
+        }
+        ClassifierIndex::Scan(n.rules, key, best);
+        if (n.length == 128) {
+            break;
+        }
+        node = n.child[Bit128(address, n.length)];
+    }
+}
+
+void ClassifierIndex::IntervalIndex::Clear() {
+    m_pending.clear();
+    m_starts.clear();
+    m_segments.clear();
+}
+
+void ClassifierIndex::IntervalIndex::Insert(uint32_t low, uint32_t high, const Rule& rule) {
+    m_pending.push_back(Interval{low, high, rule});
+}
+
+/**
+ * @brief Splits the inserted intervals into disjoint segments.
+ *
+ * Sweeps the interval end points in order, keeping the intervals covering the current
+ * point in a set ordered by class index. Each segment keeps the covering rules in class
+ * order, cut after the first rule that needs no verification since no later rule can
+ * win over it. Lookups then binary-search the segment start points.
+ */
+void ClassifierIndex::IntervalIndex::Finalize() {
+    struct Event {
+        uint32_t point;
+        bool open;
+        uint32_t interval;
+    };
+    std::vector<Event> events;
+    events.reserve(m_pending.size() * 2);
+    for (uint32_t i = 0; i < m_pending.size(); ++i) {
+        events.push_back(Event{m_pending[i].low, true, i});
+        events.push_back(Event{m_pending[i].high + 1, false, i});
+    }
+    std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+        return a.point < b.point;
+    });
+
+    std::set<std::pair<uint32_t, uint32_t>> active;  // (class index, interval)
+    m_starts.clear();
+    m_segments.clear();
+    for (size_t e = 0; e < events.size();) {
+        uint32_t point = events[e].point;
+        for (; e < events.size() && events[e].point == point; ++e) {
+            std::pair<uint32_t, uint32_t> entry(m_pending[events[e].interval].rule.classIndex, events[e].interval);
+            if (events[e].open) {
+                active.insert(entry);
+            } else {
+                active.erase(entry);
+            }
+        }
+        RuleList rules;
+        for (const std::pair<uint32_t, uint32_t>& entry : active) {
+            rules.push_back(m_pending[entry.second].rule);
+            if (rules.back().anchorOnly) {
+                break;
+            }
+        }
+        m_starts.push_back(point);
+        m_segments.push_back(rules);
+    }
+    m_pending.clear();
+}
+
+/**
+ * @brief Checks the rules of the segment containing the given port.
+ *
+ * @param point The packet's port.
+ * @param key The packet's flow key, used to verify multi-element filters.
+ * @param best Lowest matching class index found so far; lowered when a better match is found.
+ */
+void ClassifierIndex::IntervalIndex::Lookup(uint32_t point, const FlowKey& key, uint32_t& best) const {
+    auto it = std::upper_bound(m_starts.begin(), m_starts.end(), point);
+    if (it == m_starts.begin()) {
+        return;
+    }
+    ClassifierIndex::Scan(m_segments[it - m_starts.begin() - 1], key, best);
+}
+
+ClassifierIndex::ClassifierIndex() : m_built(false), m_noMatch(0), m_catchAll(0), m_dscpOnly(false) {
+}
+
+void ClassifierIndex::Clear() {
+    m_built = false;
+    m_noMatch = 0;
+    m_catchAll = 0;
+    m_srcAddress.clear();
+    m_dstAddress.clear();
+    m_srcPort.clear();
+    m_dstPort.clear();
+    m_protocol.clear();
+    m_nextHeader.clear();
+    m_srcPrefix.Clear();
+    m_dstPrefix.Clear();
+    m_srcPrefix6.Clear();
+    m_dstPrefix6.Clear();
+    m_srcPortRanges.Clear();
+    m_dstPortRanges.Clear();
+    m_dscp.clear();
+    m_residual.clear();
+    m_dscpOnly = false;
+}
+
+bool ClassifierIndex::IsBuilt() const {
+    return m_built;
+}
+
+/**
+ * @brief Tells whether classification reduces to the 64-entry DSCP table.
+ */
+bool ClassifierIndex::IsDscpOnly() const {
+    return m_dscpOnly;
+}
+
+/**
+ * @brief Compiles the filters of the given classes into the lookup structures.
+ *
+ * Classes are visited in order, so every rule list ends up sorted by class index. Classes
+ * after the first one that accepts everything can never win and are not indexed.
+ *
+ * @param classes The traffic classes, in classification order.
+ */
+void ClassifierIndex::Build(const std::vector<Ptr<TrafficClass>>& classes) {
+    Clear();
+    m_noMatch = classes.size();
+    m_catchAll = m_noMatch;
+    if (BuildDscpTable(classes)) {
+        m_dscpOnly = true;
+        m_built = true;
+        return;
+    }
+
+    for (uint32_t i = 0; i < classes.size() && m_catchAll == m_noMatch; ++i) {
+        const std::vector<Filter*>& filters = classes[i]->GetFilters();
+        if (filters.empty()) {
+            m_catchAll = i;
+            break;
+        }
+        for (Filter* filter : filters) {
+            if (filter->elements.empty()) {
+                m_catchAll = i;
+                break;
+            }
+            MatchSpec anchor = filter->elements[0]->GetSpec();
+            for (size_t e = 1; e < filter->elements.size(); ++e) {
+                MatchSpec spec = filter->elements[e]->GetSpec();
+                if (AnchorScore(spec) > AnchorScore(anchor)) {
+                    anchor = spec;
+                }
+            }
+            Insert(Rule{i, filter, filter->elements.size() == 1}, anchor);
+        }
+    }
+    m_srcPortRanges.Finalize();
+    m_dstPortRanges.Finalize();
+    m_built = true;
+}
+
+/**
+ * @brief Builds the code point to class table if every filter only tests the DSCP.
+ *
+ * Entries are filled in class order, so each code point maps to the first class that
+ * accepts it; code points no filter names fall through to the first catch-all class.
+ *
+ * @param classes The traffic classes, in classification order.
+ * @return False, leaving the table unused, if some filter tests another field.
+ */
+bool ClassifierIndex::BuildDscpTable(const std::vector<Ptr<TrafficClass>>& classes) {
+    const uint32_t unset = UINT32_MAX;
+    m_dscpTable.fill(unset);
+    uint32_t catchAll = m_noMatch;
+    for (uint32_t i = 0; i < classes.size() && catchAll == m_noMatch; ++i) {
+        const std::vector<Filter*>& filters = classes[i]->GetFilters();
+        if (filters.empty()) {
+            catchAll = i;
+        }
+        for (Filter* filter : filters) {
+            if (filter->elements.empty()) {
+                catchAll = i;
+                continue;
+            }
+            uint32_t dscp = unset;
+            bool satisfiable = true;
+            for (FilterElement* element : filter->elements) {
+                MatchSpec spec = element->GetSpec();
+                if (spec.field != MatchField::Dscp) {
+                    return false;
+                }
+                satisfiable = satisfiable && (dscp == unset || dscp == spec.value) && spec.value < 64;
+                dscp = spec.value;
+            }
+            if (satisfiable && m_dscpTable[dscp] == unset) {
+                m_dscpTable[dscp] = i;
+            }
+        }
+    }
+    for (uint32_t& entry : m_dscpTable) {
+        entry = std::min(entry, catchAll);
+    }
+    m_catchAll = catchAll;
+    return true;
+}
+
+void ClassifierIndex::Insert(const Rule& rule, const MatchSpec& anchor) {
+    if (AnchorScore(anchor) == 0) {
+        m_residual.push_back(Rule{rule.classIndex, rule.filter, false});
+        return;
+    }
+    switch (anchor.field) {
+    case MatchField::SrcAddress:
+        if (anchor.mask == 0xffffffff) {
+            m_srcAddress[anchor.value].push_back(rule);
+        } else {
+            m_srcPrefix.Insert(anchor.value, std::bitset<32>(anchor.mask).count(), rule);
+        }
+        break;
+    case MatchField::DstAddress:
+        if (anchor.mask == 0xffffffff) {
+            m_dstAddress[anchor.value].push_back(rule);
+        } else {
+            m_dstPrefix.Insert(anchor.value, std::bitset<32>(anchor.mask).count(), rule);
+        }
+        break;
+    case MatchField::SrcAddress6:
+        m_srcPrefix6.Insert(anchor.value6, anchor.mask, rule);
+        break;
+    case MatchField::DstAddress6:
+        m_dstPrefix6.Insert(anchor.value6, anchor.mask, rule);
+        break;
+    case MatchField::SrcPort:
+        if (anchor.value == anchor.high) {
+            m_srcPort[anchor.value].push_back(rule);
+        } else {
+            m_srcPortRanges.Insert(anchor.value, anchor.high, rule);
+        }
+        break;
+    case MatchField::DstPort:
+        if (anchor.value == anchor.high) {
+            m_dstPort[anchor.value].push_back(rule);
+        } else {
+            m_dstPortRanges.Insert(anchor.value, anchor.high, rule);
+        }
+        break;
+    case MatchField::Protocol:
+        m_protocol[anchor.value].push_back(rule);
+        break;
+    case MatchField::NextHeader:
+        m_nextHeader[anchor.value].push_back(rule);
+        break;
+    case MatchField::Dscp:
+        m_dscp[anchor.value].push_back(rule);
+        break;
+    default:
+        m_residual.push_back(Rule{rule.classIndex, rule.filter, false});
+        break;
+    }
+}
+
+/**
+ * @brief Checks a class-ordered rule list, stopping at the first rule that cannot improve on best.
+ */
+void ClassifierIndex::Scan(const RuleList& rules, const FlowKey& key, uint32_t& best) {
+    for (const Rule& rule : rules) {
+        if (rule.classIndex >= best) {
+            return;
+        }
+        if (rule.anchorOnly || rule.filter->match(key)) {
+            best = rule.classIndex;
+            return;
+        }
+    }
+}
+
+void ClassifierIndex::Probe(const std::unordered_map<uint32_t, RuleList>& table, uint32_t value,
+                            const FlowKey& key, uint32_t& best) {
+    if (table.empty()) {
+        return;
+    }
+    auto it = table.find(value);
+    if (it != table.end()) {
+        Scan(it->second, key, best);
+    }
+}
+
+/**
+ * @brief Returns the index of the first class whose filters accept the packet.
+ *
+ * @param key Header fields extracted from the packet to be classified.
+ * @return The matching class index, or the number of classes if none matches.
+ */
+uint32_t ClassifierIndex::Lookup(const FlowKey& key) const {
+    if (m_dscpOnly) {
+        return key.valid ? m_dscpTable[key.dscp] : m_catchAll;
+    }
+    uint32_t best = m_catchAll;
+    if (key.valid) {
+        if (!key.ipv6) {
+            Probe(m_srcAddress, key.srcAddress, key, best);
+            Probe(m_dstAddress, key.dstAddress, key, best);
+        } else {
+            m_srcPrefix6.Lookup(key.srcAddress6, key, best);
+            m_dstPrefix6.Lookup(key.dstAddress6, key, best);
+        }
+        if (key.hasPorts) {
+            Probe(m_dstPort, key.dstPort, key, best);
+            Probe(m_srcPort, key.srcPort, key, best);
+            m_dstPortRanges.Lookup(key.dstPort, key, best);
+            m_srcPortRanges.Lookup(key.srcPort, key, best);
+        }
+        Probe(m_dscp, key.dscp, key, best);
+        if (!key.ipv6) {
+            Probe(m_protocol, key.protocol, key, best);
+            m_srcPrefix.Lookup(key.srcAddress, key, best);
+            m_dstPrefix.Lookup(key.dstAddress, key, best);
+        } else {
+            Probe(m_nextHeader, key.protocol, key, best);
+        }
+    }
+    Scan(m_residual, key, best);
+    return best;
+}
+
+} // namespace ns3
@@ -0,0 +1,135 @@
+#ifndef CLASSIFIER_INDEX_H
+#define CLASSIFIER_INDEX_H
+
+#include "ns3/ptr.h"
+#include "flow-key.h"
+#include "filter.h"
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+class TrafficClass;
+
+/**
+ * @brief Lookup structure compiled from the filters of an ordered list of traffic classes.
+ *
+ * Each Filter is stored once, under the element that narrows it down best (its anchor):
+ * exact addresses, ports and protocols go into hash tables, IPv4 address masks into binary
+ * prefix tries, IPv6 addresses and prefixes into path-compressed tries and port ranges
+ * into interval indexes. A lookup probes each structure once
+ * and keeps the lowest class index whose filter matches, which is the same answer the
+ * ordered class × filter × element scan gives.
+ * Filters whose other elements still need checking are verified with Filter::match.
+ *
+ * When every filter tests nothing but the DSCP, the index is reduced to a 64-entry table
+ * from code point to class and a lookup is a single array read.
+ */
+class ClassifierIndex {
+public:
+    ClassifierIndex();
+
+    void Build(const std::vector<Ptr<TrafficClass>>& classes);
+    void Clear();
+    bool IsBuilt() const;
+    bool IsDscpOnly() const;
+    uint32_t Lookup(const FlowKey& key) const;
+
+private:
+    struct Rule {
+        uint32_t classIndex;
+        Filter* filter;
+        bool anchorOnly;  // the anchor is the filter's only element, no verification needed
+    };
+    typedef std::vector<Rule> RuleList;
+
+    class PrefixTrie {
+    public:
+        PrefixTrie();
+        void Insert(uint32_t value, uint32_t prefixLength, const Rule& rule);
+        void Lookup(uint32_t address, const FlowKey& key, uint32_t& best) const;
+        void Clear();
+
+    private:
+        struct Node {
+            int32_t child[2];
+            RuleList rules;
+        };
+        std::vector<Node> m_nodes;
+    };
+
+    /**
+     * @brief Path-compressed binary trie over 128-bit IPv6 prefixes.
+     *
+     * Chains of single-child nodes are collapsed, so every node either holds rules or
+     * branches and the depth is bounded by the number of distinct prefixes on a path
+     * rather than by 128.
+     */
+    class CompressedTrie {
+    public:
+        CompressedTrie();
+        void Insert(const uint64_t value[2], uint32_t prefixLength, const Rule& rule);
+        void Lookup(const uint64_t address[2], const FlowKey& key, uint32_t& best) const;
+        void Clear();
+
+    private:
+        struct Node {
+            uint64_t prefix[2];  // masked to length bits
+            uint32_t length;
+            int32_t child[2];
+            RuleList rules;
+        };
+        int32_t NewNode(const uint64_t value[2], uint32_t length);
+        std::vector<Node> m_nodes;
+    };
+
+    class IntervalIndex {
+    public:
+        void Insert(uint32_t low, uint32_t high, const Rule& rule);
+        void Finalize();
+        void Lookup(uint32_t point, const FlowKey& key, uint32_t& best) const;
+        void Clear();
+
+    private:
+        struct Interval {
+            uint32_t low;
+            uint32_t high;
+            Rule rule;
+        };
+        std::vector<Interval> m_pending;     // inserted, not yet split into segments
+        std::vector<uint32_t> m_starts;      // sorted start point of each segment
+        std::vector<RuleList> m_segments;    // rules covering each segment, by class index
+    };
+
+    void Insert(const Rule& rule, const MatchSpec& anchor);
+    bool BuildDscpTable(const std::vector<Ptr<TrafficClass>>& classes);
+    static void Scan(const RuleList& rules, const FlowKey& key, uint32_t& best);
+    static void Probe(const std::unordered_map<uint32_t, RuleList>& table, uint32_t value,
+                      const FlowKey& key, uint32_t& best);
+
+    bool m_built;
+    uint32_t m_noMatch;   // returned when no class matches (the number of classes)
+    uint32_t m_catchAll;  // lowest class that accepts every packet
+    std::unordered_map<uint32_t, RuleList> m_srcAddress;
+    std::unordered_map<uint32_t, RuleList> m_dstAddress;
+    std::unordered_map<uint32_t, RuleList> m_srcPort;
+    std::unordered_map<uint32_t, RuleList> m_dstPort;
+    std::unordered_map<uint32_t, RuleList> m_protocol;
+    std::unordered_map<uint32_t, RuleList> m_nextHeader;
+    PrefixTrie m_srcPrefix;
+    PrefixTrie m_dstPrefix;
+    CompressedTrie m_srcPrefix6;
+    CompressedTrie m_dstPrefix6;
+    IntervalIndex m_srcPortRanges;
+    IntervalIndex m_dstPortRanges;
+    std::unordered_map<uint32_t, RuleList> m_dscp;
+    RuleList m_residual;  // filters without an indexable element
+    bool m_dscpOnly;
+    std::array<uint32_t, 64> m_dscpTable;
+};
+
+} // namespace ns3
+
+#endif /* CLASSIFIER_INDEX_H */
@@ -0,0 +1,157 @@
+#include "config-parser.h"
+#include <charconv>
+#include <fstream>
+
+namespace ns3 {
+
+ConfigParser::ConfigParser() : m_offset(0), m_lineNumber(0) {
+}
+
+/**
+ * @brief Reads a whole config file into memory.
+ *
+ * @param filename The config file.
+ * @return True if the file could be read; otherwise GetError() says why.
+ */
+bool ConfigParser::Open(const std::string& filename) {
+    m_filename = filename;
+    m_offset = 0;
+    m_lineNumber = 0;
+    m_words.clear();
+    m_error.clear();
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        m_error = "Failed to open config file: " + filename;
+        return false;
+    }
+    m_text.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    if (!file.read(m_text.data(), m_text.size())) {
+        m_error = "Failed to read config file: " + filename;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Moves to the next line that has words, splitting it at spaces and tabs.
+ *
+ * @return False at the end of the file, or once an error was recorded.
+ */
+bool ConfigParser::NextLine() {
+    m_words.clear();
+    while (m_error.empty() && m_offset < m_text.size()) {
+        size_t end = m_text.find('\n', m_offset);
+        if (end == std::string::npos) {
+            end = m_text.size();
+        }
+        std::string_view line(m_text.data() + m_offset, end - m_offset);
+        m_offset = end + 1;
+        ++m_lineNumber;
+        line = line.substr(0, line.find('#'));
+
+        size_t pos = 0;
+        while (true) {
+            pos = line.find_first_not_of(" \t\r", pos);
+            if (pos == std::string_view::npos) {
+                break;
+            }
+            size_t stop = line.find_first_of(" \t\r", pos);
+            if (stop == std::string_view::npos) {
+                stop = line.size();
+            }
+            m_words.push_back(line.substr(pos, stop - pos));
+            pos = stop;
+        }
+        if (!m_words.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t ConfigParser::GetLineNumber() const {
+    return m_lineNumber;
+}
+
+size_t ConfigParser::GetNWords() const {
+    return m_words.size();
+}
+
+/**
+ * @brief Returns a word of the current line, or an empty view past its last word.
+ */
+std::string_view ConfigParser::GetWord(size_t index) const {
+    return index < m_words.size() ? m_words[index] : std::string_view();
+}
+
+/**
+ * @brief Checks the number of words on the current line, keyword included.
+ *
+ * @param min The fewest words the line may have.
+ * @param max The most words the line may have.
+ * @return True if the count is in range; otherwise an error is recorded.
+ */
+bool ConfigParser::ExpectWords(size_t min, size_t max) {
+    if (m_words.size() >= min && m_words.size() <= max) {
+        return true;
+    }
+    std::string expected = std::to_string(min - 1);
+    if (max != min) {
+        expected += max == SIZE_MAX ? " or more" : " to " + std::to_string(max - 1);
+    }
+    return Error("'" + std::string(m_words[0]) + "' takes " + expected + " arguments, got "
+                 + std::to_string(m_words.size() - 1));
+}
+
+bool ConfigParser::GetUint32(size_t index, uint32_t& value) {
+    std::string_view word = GetWord(index);
+    auto [end, ec] = std::from_chars(word.data(), word.data() + word.size(), value);
+    return (ec == std::errc() && end == word.data() + word.size() && !word.empty())
+           || Malformed(index, "an unsigned 32-bit integer");
+}
+
+bool ConfigParser::GetUint64(size_t index, uint64_t& value) {
+    std::string_view word = GetWord(index);
+    auto [end, ec] = std::from_chars(word.data(), word.data() + word.size(), value);
+    return (ec == std::errc() && end == word.data() + word.size() && !word.empty())
+           || Malformed(index, "an unsigned integer");
+}
+
+bool ConfigParser::GetDouble(size_t index, double& value) {
+    std::string_view word = GetWord(index);
+    auto [end, ec] = std::from_chars(word.data(), word.data() + word.size(), value);
+    return (ec == std::errc() && end == word.data() + word.size() && !word.empty())
+           || Malformed(index, "a number");
+}
+
+/**
+ * @brief Records an error on the current line, unless one was recorded already.
+ *
+ * @param message What is wrong with the line.
+ * @return False, so parsers can return Error(...) directly.
+ */
+bool ConfigParser::Error(const std::string& message) {
+    if (m_error.empty()) {
+        m_error = m_filename + ":" + std::to_string(m_lineNumber) + ": " + message;
+    }
+    return false;
+}
+
+bool ConfigParser::HasError() const {
+    return !m_error.empty();
+}
+
+/**
+ * @brief Returns the first error, as "file:line: message", or an empty string.
+ */
+const std::string& ConfigParser::GetError() const {
+    return m_error;
+}
+
+bool ConfigParser::Malformed(size_t index, const char* expected) {
+    return Error("expected " + std::string(expected) + " for argument " + std::to_string(index)
+                 + " of '" + std::string(GetWord(0)) + "', got '" + std::string(GetWord(index)) + "'");
+}
+
+} // namespace ns3
@@ -0,0 +1,53 @@
+#ifndef CONFIG_PARSER_H
+#define CONFIG_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * @brief Reads a scheduler config file one line at a time, split into words.
+ *
+ * The file is read into memory in one go and each line split in place, so a line costs
+ * no allocation; "#" starts a comment and blank lines are skipped. The typed getters
+ * validate a word and, when it is malformed, record an error naming the file and line.
+ * The first error ends the parse: NextLine() returns false from then on.
+ */
+class ConfigParser {
+public:
+    ConfigParser();
+
+    bool Open(const std::string& filename);
+    bool NextLine();
+
+    uint32_t GetLineNumber() const;
+    size_t GetNWords() const;
+    std::string_view GetWord(size_t index) const;
+
+    bool ExpectWords(size_t min, size_t max);
+    bool GetUint32(size_t index, uint32_t& value);
+    bool GetUint64(size_t index, uint64_t& value);
+    bool GetDouble(size_t index, double& value);
+
+    bool Error(const std::string& message);
+    bool HasError() const;
+    const std::string& GetError() const;
+
+private:
+    bool Malformed(size_t index, const char* expected);
+
+    std::string m_filename;
+    std::string m_text;
+    size_t m_offset;                       // start of the next line in m_text
+    uint32_t m_lineNumber;
+    std::vector<std::string_view> m_words;  // of the current line, into m_text
+    std::string m_error;
+};
+
+} // namespace ns3
+
+#endif /* CONFIG_PARSER_H */
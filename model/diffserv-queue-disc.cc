@@ -0,0 +1,304 @@
+#include "diffserv-queue-disc.h"
+#include "ns3/log.h"
+#include "ns3/string.h"
+#include "ns3/simulator.h"
+#include "ns3/ipv4-queue-disc-item.h"
+#include "ns3/ipv6-queue-disc-item.h"
+#include <limits>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("DiffServQueueDisc");
+
+NS_OBJECT_ENSURE_REGISTERED(DiffServItemQueue);
+NS_OBJECT_ENSURE_REGISTERED(DiffServQueueDisc);
+
+TypeId DiffServItemQueue::GetTypeId(void) {
+    static TypeId tid = TypeId("ns3::DiffServItemQueue")
+        .SetParent<Queue<QueueDiscItem>>()
+        .SetGroupName("TrafficControl")
+        .AddConstructor<DiffServItemQueue>();
+    return tid;
+}
+
+DiffServItemQueue::DiffServItemQueue() {
+}
+
+/**
+ * @brief Sets the scheduler that classifies and orders the items.
+ *
+ * Takes over the scheduler's DSCP and ECN rewrites, which must act on the items'
+ * headers, its drops after dequeue, which must remove the items, and the flow keys it
+ * reclassifies queued packets by on DiffServ::Reload().
+ *
+ * @param s The scheduler, with its traffic classes configured.
+ */
+void DiffServItemQueue::SetScheduler(Ptr<DiffServ> s) {
+    scheduler = s;
+    scheduler->SetMarkCallbacks(MakeCallback(&DiffServItemQueue::SetDscp, this),
+                                MakeCallback(&DiffServItemQueue::SetEcnCe, this));
+    scheduler->TraceConnectWithoutContext("DropAfterDequeue",
+                                          MakeCallback(&DiffServItemQueue::SchedulerDropped, this));
+    scheduler->SetFlowKeyCallback(MakeCallback(&DiffServItemQueue::KeyOf, this));
+}
+
+Ptr<DiffServ> DiffServItemQueue::GetScheduler() const {
+    return scheduler;
+}
+
+/**
+ * @brief Sets how items the AQM marks get ECN CE; by default QueueDiscItem::Mark().
+ *
+ * @param cb The callback; returns false if the item is not ECN-capable.
+ */
+void DiffServItemQueue::SetMarkCallback(Callback<bool, Ptr<QueueDiscItem>> cb) {
+    mark = cb;
+}
+
+/**
+ * @brief Classifies an item by its header and queues it in the scheduler.
+ *
+ * The scheduler charges the item's full size, IP header included, to its class.
+ * Items the scheduler rejects are dropped before enqueue.
+ *
+ * @param item The item to enqueue.
+ * @return True if the item was queued.
+ */
+bool DiffServItemQueue::Enqueue(Ptr<QueueDiscItem> item) {
+    arriving = item;
+    bool accepted = scheduler->Enqueue(item->GetPacket(), FlowKey::Extract(*item));
+    item = arriving;  // the policer may have remarked it
+    arriving = nullptr;
+    if (!accepted) {
+        NS_LOG_LOGIC("Item dropped by the scheduler");
+        DropBeforeEnqueue(item);
+        return false;
+    }
+    Iterator position;
+    DoEnqueue(GetContainer().end(), item, position);
+    positions[PeekPointer(item->GetPacket())] = position;
+    return true;
+}
+
+/**
+ * @brief Dequeues the item whose packet the scheduler sends next.
+ *
+ * @return The item, or nullptr if the scheduler has nothing to send.
+ */
+Ptr<QueueDiscItem> DiffServItemQueue::Dequeue() {
+    Ptr<Packet> p = scheduler->Dequeue();
+    if (!p) {
+        return nullptr;
+    }
+    auto it = positions.find(PeekPointer(p));
+    NS_ASSERT_MSG(it != positions.end(), "Scheduler returned a packet without an item");
+    Iterator position = it->second;
+    positions.erase(it);
+    return DoDequeue(position);
+}
+
+/**
+ * @brief Removes the item whose packet the scheduler would send next, as a drop.
+ *
+ * The scheduler reports the drop, and SchedulerDropped() takes the item out of the list.
+ *
+ * @return The item, or nullptr if the scheduler has nothing to send.
+ */
+Ptr<QueueDiscItem> DiffServItemQueue::Remove() {
+    Ptr<const Packet> p = scheduler->Peek();
+    if (!p) {
+        return nullptr;
+    }
+    Ptr<QueueDiscItem> item = ItemOf(p);
+    scheduler->Remove();
+    return item;
+}
+
+Ptr<const QueueDiscItem> DiffServItemQueue::Peek() const {
+    Ptr<const Packet> p = scheduler->Peek();
+    if (!p) {
+        return nullptr;
+    }
+    return *positions.at(PeekPointer(p));
+}
+
+void DiffServItemQueue::DoDispose() {
+    positions.clear();
+    arriving = nullptr;
+    scheduler = nullptr;
+    Queue<QueueDiscItem>::DoDispose();
+}
+
+/**
+ * @brief Returns the item that carries a packet the scheduler holds or is admitting.
+ */
+Ptr<QueueDiscItem>& DiffServItemQueue::ItemOf(Ptr<const Packet> p) {
+    if (arriving && arriving->GetPacket() == p) {
+        return arriving;
+    }
+    return *positions.at(PeekPointer(p));
+}
+
+/**
+ * @brief Returns the flow key of a queued packet, from the header of its item.
+ */
+FlowKey DiffServItemQueue::KeyOf(Ptr<const Packet> p) {
+    return FlowKey::Extract(*ItemOf(p));
+}
+
+/**
+ * @brief Drops the item of a packet the scheduler dropped after enqueue, e.g. by CoDel.
+ */
+void DiffServItemQueue::SchedulerDropped(Ptr<const Packet> p) {
+    auto it = positions.find(PeekPointer(p));
+    if (it == positions.end()) {
+        return;
+    }
+    Iterator position = it->second;
+    positions.erase(it);
+    NS_LOG_LOGIC("Item dropped by the scheduler after enqueue");
+    DoRemove(position);
+}
+
+/**
+ * @brief Rewrites the DSCP of a packet's item.
+ *
+ * Queue disc items expose their header read-only, so the item is replaced by one with
+ * the rewritten header. This only happens while the policer admits the item.
+ *
+ * @return False if the item carries neither an IPv4 nor an IPv6 header.
+ */
+bool DiffServItemQueue::SetDscp(Ptr<Packet> p, uint8_t dscp) {
+    Ptr<QueueDiscItem>& item = ItemOf(p);
+    Ptr<QueueDiscItem> remarked;
+    if (Ptr<Ipv4QueueDiscItem> ipv4 = DynamicCast<Ipv4QueueDiscItem>(item)) {
+        Ipv4Header header = ipv4->GetHeader();
+        header.SetTos(static_cast<uint8_t>((dscp << 2) | (header.GetTos() & 0x03)));
+        remarked = Create<Ipv4QueueDiscItem>(p, item->GetAddress(), item->GetProtocol(), header);
+    } else if (Ptr<Ipv6QueueDiscItem> ipv6 = DynamicCast<Ipv6QueueDiscItem>(item)) {
+        Ipv6Header header = ipv6->GetHeader();
+        header.SetTrafficClass(static_cast<uint8_t>((dscp << 2) | (header.GetTrafficClass() & 0x03)));
+        remarked = Create<Ipv6QueueDiscItem>(p, item->GetAddress(), item->GetProtocol(), header);
+    } else {
+        return false;
+    }
+    remarked->SetTxQueueIndex(item->GetTxQueueIndex());
+    remarked->SetTimeStamp(Simulator::Now());
+    item = remarked;
+    return true;
+}
+
+bool DiffServItemQueue::SetEcnCe(Ptr<Packet> p) {
+    Ptr<QueueDiscItem> item = ItemOf(p);
+    return mark.IsNull() ? item->Mark() : mark(item);
+}
+
+/**
+ * @brief Returns the TypeId for DiffServQueueDisc.
+ *
+ * Registers the abstract DiffServQueueDisc base and the config file attribute its
+ * subclasses read.
+ *
+ * @return The TypeId of the DiffServQueueDisc class.
+ */
+TypeId DiffServQueueDisc::GetTypeId(void) {
+    static TypeId tid = TypeId("ns3::DiffServQueueDisc")
+        .SetParent<QueueDisc>()
+        .SetGroupName("TrafficControl")
+        .AddAttribute("ConfigFile",
+                      "Scheduler config file, in the format of the matching DiffServ queue.",
+                      StringValue(""),
+                      MakeStringAccessor(&DiffServQueueDisc::configFile),
+                      MakeStringChecker());
+    return tid;
+}
+
+/**
+ * @brief Creates the queue disc around a scheduler without traffic classes.
+ *
+ * Like DiffServ, the queue disc bounds each class and, optionally, the shared buffer
+ * rather than the total, so it has no MaxSize of its own.
+ *
+ * @param scheduler The scheduler, configured by ReadConfigFile().
+ */
+DiffServQueueDisc::DiffServQueueDisc(Ptr<DiffServ> scheduler)
+    : QueueDisc(QueueDiscSizePolicy::NO_LIMITS), scheduler(scheduler) {
+}
+
+DiffServQueueDisc::~DiffServQueueDisc() {
+}
+
+Ptr<DiffServ> DiffServQueueDisc::GetScheduler() const {
+    return scheduler;
+}
+
+void DiffServQueueDisc::DoDispose() {
+    if (scheduler) {
+        scheduler->Dispose();
+        scheduler = nullptr;
+    }
+    QueueDisc::DoDispose();
+}
+
+bool DiffServQueueDisc::DoEnqueue(Ptr<QueueDiscItem> item) {
+    // Drops are reported by the internal queue's traces
+    return GetInternalQueue(0)->Enqueue(item);
+}
+
+/**
+ * @brief Dequeues the next item of the scheduler.
+ *
+ * DoPeek() is left to QueueDisc, which dequeues the item and holds it: the scheduler's
+ * own Peek() may name a packet its class's AQM then drops.
+ *
+ * @return The item, or nullptr if no class may send.
+ */
+Ptr<QueueDiscItem> DiffServQueueDisc::DoDequeue() {
+    return GetInternalQueue(0)->Dequeue();
+}
+
+/**
+ * @brief Reads the scheduler config and creates the internal queue.
+ *
+ * Classification is done by the scheduler's filters, so the queue disc accepts no
+ * packet filters, classes or internal queues of its own. The scheduler wakes the queue
+ * disc when a shaped class becomes eligible again.
+ *
+ * @return True if the config was read and defines at least one traffic class.
+ */
+bool DiffServQueueDisc::CheckConfig() {
+    if (GetNQueueDiscClasses() > 0 || GetNPacketFilters() > 0 || GetNInternalQueues() > 0) {
+        NS_LOG_ERROR("DiffServQueueDisc needs no queue disc classes, packet filters or internal queues");
+        return false;
+    }
+    if (configFile.empty() || !ReadConfigFile(configFile)) {
+        NS_LOG_ERROR("DiffServQueueDisc could not read config file '" << configFile << "'");
+        return false;
+    }
+    if (scheduler->GetQueues().empty()) {
+        NS_LOG_ERROR("Config file " << configFile << " defines no traffic classes");
+        return false;
+    }
+    QueueSize unlimited(QueueSizeUnit::PACKETS, std::numeric_limits<uint32_t>::max());
+    scheduler->SetMaxSize(unlimited);
+    scheduler->SetWakeupCallback(MakeCallback(&QueueDisc::Run, this));
+
+    Ptr<DiffServItemQueue> queue = CreateObject<DiffServItemQueue>();
+    queue->SetMaxSize(unlimited);
+    queue->SetScheduler(scheduler);
+    queue->SetMarkCallback(MakeCallback(&DiffServQueueDisc::MarkItem, this));
+    AddInternalQueue(queue);
+    return true;
+}
+
+void DiffServQueueDisc::InitializeParams() {
+}
+
+/**
+ * @brief ECN-marks an item through QueueDisc::Mark(), so it shows in the queue disc's stats.
+ */
+bool DiffServQueueDisc::MarkItem(Ptr<QueueDiscItem> item) {
+    return Mark(item, AQM_MARK);
+}
+
+} // namespace ns3
@@ -0,0 +1,88 @@
+#ifndef DIFFSERV_QUEUE_DISC_H
+#define DIFFSERV_QUEUE_DISC_H
+
+#include "ns3/queue-disc.h"
+#include "ns3/queue.h"
+#include "diffserv.h"
+#include <string>
+#include <unordered_map>
+
+namespace ns3 {
+
+/**
+ * @brief Internal queue of DiffServQueueDisc: holds queue disc items in the order a DiffServ
+ * scheduler serves them.
+ *
+ * Each item's packet is handed to the scheduler, classified by the item's header, and
+ * the item itself kept in the Queue<QueueDiscItem> list, found again through its
+ * packet. Items therefore leave in the scheduler's order, and every enqueue, dequeue
+ * and drop, including AQM drops inside the scheduler, shows up in this queue's traces,
+ * which the queue disc accounts from.
+ */
+class DiffServItemQueue : public Queue<QueueDiscItem> {
+public:
+    static TypeId GetTypeId(void);
+    DiffServItemQueue();
+
+    void SetScheduler(Ptr<DiffServ> scheduler);
+    Ptr<DiffServ> GetScheduler() const;
+    void SetMarkCallback(Callback<bool, Ptr<QueueDiscItem>> cb);
+
+    bool Enqueue(Ptr<QueueDiscItem> item) override;
+    Ptr<QueueDiscItem> Dequeue() override;
+    Ptr<QueueDiscItem> Remove() override;
+    Ptr<const QueueDiscItem> Peek() const override;
+
+protected:
+    void DoDispose() override;
+
+private:
+    Ptr<QueueDiscItem>& ItemOf(Ptr<const Packet> p);
+    FlowKey KeyOf(Ptr<const Packet> p);
+    void SchedulerDropped(Ptr<const Packet> p);
+    bool SetDscp(Ptr<Packet> p, uint8_t dscp);
+    bool SetEcnCe(Ptr<Packet> p);
+
+    Ptr<DiffServ> scheduler;
+    std::unordered_map<const Packet*, Iterator> positions;  // queued items by their packet
+    Ptr<QueueDiscItem> arriving;                            // item being admitted by the scheduler
+    Callback<bool, Ptr<QueueDiscItem>> mark;
+};
+
+/**
+ * @brief Queue disc running a DiffServ scheduler in the traffic control layer.
+ *
+ * Offers the schedulers' traffic classes, filters, policers, shapers and AQM to any
+ * device type, in front of the device queue, so that NetDeviceQueue flow control and
+ * byte queue limits keep the device queue short. Items are classified by their IPv4 or
+ * IPv6 header rather than by a PPP frame. Subclasses create the scheduler and read the
+ * file given by the ConfigFile attribute.
+ */
+class DiffServQueueDisc : public QueueDisc {
+public:
+    static TypeId GetTypeId(void);
+    ~DiffServQueueDisc() override;
+
+    Ptr<DiffServ> GetScheduler() const;
+
+    static constexpr const char* AQM_MARK = "Marked by the AQM of its traffic class";
+
+protected:
+    explicit DiffServQueueDisc(Ptr<DiffServ> scheduler);
+    void DoDispose() override;
+
+private:
+    bool DoEnqueue(Ptr<QueueDiscItem> item) override;
+    Ptr<QueueDiscItem> DoDequeue() override;
+    bool CheckConfig() override;
+    void InitializeParams() override;
+    virtual bool ReadConfigFile(const std::string& filename) = 0;
+    bool MarkItem(Ptr<QueueDiscItem> item);
+
+    Ptr<DiffServ> scheduler;
+    std::string configFile;
+};
+
+} // namespace ns3
+
+#endif /* DIFFSERV_QUEUE_DISC_H */
@@ -1,33 +1,187 @@
 #include "diffserv.h"
+#include "ns3/log.h"
 #include "ns3/packet.h"
+#include "ns3/uinteger.h"
+#include "ns3/enum.h"
+#include "ns3/double.h"
+#include "ns3/assert.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include "ns3/data-rate.h"
+#include "ns3/object-factory.h"
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
 
 namespace ns3 {
 
-DiffServ::DiffServ() {}
+NS_LOG_COMPONENT_DEFINE("DiffServ");
+
+NS_OBJECT_ENSURE_REGISTERED(DiffServ);
+
+namespace {
+
+/**
+ * @brief Returns the initial value of a queue's MaxSize attribute, as Config::SetDefault()
+ * may have changed it.
+ */
+QueueSize GetDefaultMaxSize(TypeId tid) {
+    TypeId::AttributeInformation info;
+    if (!tid.LookupAttributeByName("MaxSize", &info)) {
+        return QueueSize();
+    }
+    return DynamicCast<const QueueSizeValue>(info.initialValue)->Get();
+}
+
+} // namespace
+
+/**
+ * @brief Returns the TypeId for DiffServ.
+ *
+ * Registers the abstract DiffServ base with the ns-3 object system and exposes the
+ * flow cache, shaper and buffer configuration as attributes. The MaxSize attribute
+ * inherited from QueueBase bounds what the traffic classes hold together; unless it is
+ * set, it follows the sum of the class limits.
+ *
+ * @return The TypeId of the DiffServ class.
+ */
+TypeId DiffServ::GetTypeId(void) {
+    static TypeId tid = TypeId("ns3::DiffServ")
+        .SetParent<Queue<Packet>>()
+        .SetGroupName("Network")
+        .AddAttribute("FlowCacheCapacity",
+                      "Number of flows whose classification result is cached (0 disables the cache).",
+                      UintegerValue(4096),
+                      MakeUintegerAccessor(&DiffServ::SetFlowCacheCapacity, &DiffServ::GetFlowCacheCapacity),
+                      MakeUintegerChecker<uint32_t>())
+        .AddAttribute("FlowCachePolicy",
+                      "Eviction policy of the flow cache.",
+                      EnumValue(FlowCache::CLOCK),
+                      MakeEnumAccessor<FlowCache::Policy>(&DiffServ::SetFlowCachePolicy, &DiffServ::GetFlowCachePolicy),
+                      MakeEnumChecker(FlowCache::LRU, "LRU",
+                                      FlowCache::CLOCK, "CLOCK"))
+        .AddAttribute("ShaperTick",
+                      "Granularity of the timer wheel that wakes up shaped classes.",
+                      TimeValue(MicroSeconds(10)),
+                      MakeTimeAccessor(&DiffServ::SetShaperTick, &DiffServ::GetShaperTick),
+                      MakeTimeChecker())
+        .AddAttribute("BufferSize",
+                      "Bytes of buffer shared by all traffic classes (0 keeps only the per-class packet limits).",
+                      UintegerValue(0),
+                      MakeUintegerAccessor(&DiffServ::SetBufferSize, &DiffServ::GetBufferSize),
+                      MakeUintegerChecker<uint64_t>())
+        .AddAttribute("BufferAlpha",
+                      "Default share of the free shared buffer a single class may take.",
+                      DoubleValue(1.0),
+                      MakeDoubleAccessor(&DiffServ::SetBufferAlpha, &DiffServ::GetBufferAlpha),
+                      MakeDoubleChecker<double>(0));
+    return tid;
+}
+
+DiffServ::DiffServ() : hasDecision(false), shaperTick(MicroSeconds(10)), shaperEventTick(0) {
+    flowCache.SetCapacity(4096);
+}
 
 bool DiffServ::Enqueue(Ptr<Packet> p) {
     return DoEnqueue(p);
 }
 
 /**
- * @brief Performs the actual enqueuing of a packet.
+ * @brief Enqueues a packet whose classification fields were extracted by the caller.
  *
- * Classifies the packet to determine the target queue and enqueues it.
- * Logs the outcome of the operation.
+ * Used by DiffServQueueDisc, whose packets do not start with the PPP and IP headers
+ * FlowKey::Extract(Ptr<const Packet>) parses.
+ *
+ * @param p Pointer to the packet to be enqueued.
+ * @param key The packet's flow key; its length is the size charged to the class.
+ * @return True if the packet was enqueued, false if it was dropped.
+ */
+bool DiffServ::Enqueue(Ptr<Packet> p, const FlowKey& key) {
+    return DoEnqueue(p, key);
+}
+
+/**
+ * @brief Performs the actual enqueuing of a PPP-framed packet.
+ *
+ * Extracts the packet's flow key once, then enqueues it as DoEnqueue(p, key) does.
  *
  * @param p Pointer to the packet to be enqueued.
  * @return True if the packet was successfully enqueued, false if no matching queue is found or enqueuing fails.
  */
 bool DiffServ::DoEnqueue(Ptr<Packet> p) {
-    uint32_t queue_index = Classify(p);
+    return DoEnqueue(p, FlowKey::Extract(p));
+}
+
+/**
+ * @brief Performs the actual enqueuing of a packet.
+ *
+ * Looks the packet's flow up in the flow cache; on a miss the packet is classified and
+ * the result cached. Rule sets that only test the DSCP skip
+ * the cache, since their classifier is a single table read. The packet is then enqueued in the
+ * target queue, provided the queue as a whole stays within MaxSize, the shared buffer, if
+ * enabled, admits it under the class's dynamic threshold, and the class admits it. Every
+ * queued packet is also recorded in the Queue<Packet> base, which keeps its counters and
+ * fires its Enqueue trace; rejected packets go through DropBeforeEnqueue. A shaped class
+ * whose head packet exceeds its shaper is parked on the timer wheel rather than announced
+ * to the scheduler. Logs the outcome of the operation and traces the classification
+ * result and the enqueue or drop.
+ *
+ * @param p Pointer to the packet to be enqueued.
+ * @param key The packet's flow key.
+ * @return True if the packet was successfully enqueued, false if no matching queue is found or enqueuing fails.
+ */
+bool DiffServ::DoEnqueue(Ptr<Packet> p, const FlowKey& key) {
+    uint32_t queue_index;
+    if (classifier.IsDscpOnly()) {
+        queue_index = Classify(key);
+    } else if (!flowCache.Lookup(key, queue_index)) {
+        queue_index = Classify(key);
+        flowCache.Insert(key, queue_index);
+    }
+    tracer.Record(EventTracer::CLASSIFY, queue_index, key.length);
     if (queue_index >= q_class.size()) {
-        std::cout << "DiffServ::DoEnqueue: Packet dropped (no matching queue)" << std::endl;
+        NS_LOG_DEBUG("Packet dropped (no matching queue)");
+        tracer.Record(EventTracer::DROP, queue_index, key.length);
+        DropBeforeEnqueue(p);
+        return false;
+    }
+    if (GetCurrentSize() + p > GetMaxSize()) {
+        NS_LOG_DEBUG("Packet dropped (queue full, MaxSize=" << GetMaxSize() << ")");
+        tracer.Record(EventTracer::DROP, queue_index, key.length);
+        DropBeforeEnqueue(p);
+        return false;
+    }
+    if (!bufferPool.Admit(queue_index, key.length)) {
+        NS_LOG_DEBUG("Packet dropped (queue " << queue_index << " above its buffer threshold)");
+        tracer.Record(EventTracer::DROP, queue_index, key.length);
+        DropBeforeEnqueue(p);
         return false;
     }
-    bool success = q_class[queue_index]->Enqueue(p);
-    std::cout << "DiffServ::DoEnqueue: Packet enqueued in queue " << queue_index 
-              << ", success=" << (success ? "true" : "false") << std::endl;
-    return success;
+    bool shaped = q_class[queue_index]->IsShaped();
+    bool wasEmpty = shaped && q_class[queue_index]->IsEmpty();
+    if (!q_class[queue_index]->Admit(p, key.length)) {
+        NS_LOG_LOGIC("Packet dropped by queue " << queue_index);
+        bufferPool.Release(queue_index, key.length);
+        tracer.Record(EventTracer::DROP, queue_index, key.length);
+        DropBeforeEnqueue(p);
+        return false;
+    }
+    PacketDescriptor descriptor;
+    descriptor.size = key.length;
+    descriptor.flowHash = key.Hash();
+    descriptor.classIndex = queue_index;
+    Iterator position;
+    Queue<Packet>::DoEnqueue(GetContainer().end(), p, position);
+    positions[queue_index].Push(position);
+    q_class[queue_index]->Push(p, descriptor);
+    tracer.Record(EventTracer::ENQUEUE, queue_index, key.length);
+    if (shaped && (parked[queue_index] || (wasEmpty && Park(queue_index)))) {
+        NS_LOG_LOGIC("Queue " << queue_index << " is waiting for shaper tokens");
+    } else {
+        Announce(queue_index, key.length);
+    }
+    NS_LOG_LOGIC("Packet enqueued in queue " << queue_index);
+    return true;
 }
 
 Ptr<Packet> DiffServ::Dequeue() {
@@ -37,66 +191,895 @@ Ptr<Packet> DiffServ::Dequeue() {
 /**
  * @brief Performs the actual dequeuing of a packet.
  *
- * Uses the scheduling mechanism to select a queue and dequeues a packet from it.
- * Logs the outcome of the operation.
+ * Commits the pending scheduling decision, computing it first if Peek() has not, and
+ * dequeues the chosen packet from its queue and from the Queue<Packet> base. A shaped
+ * class whose next packet exceeds its shaper is parked before the scheduler is notified.
+ * If the class's AQM drops every packet it held, the scheduler is notified of an empty
+ * dequeue and the next decision is tried. Logs and traces the outcome of the operation.
  *
  * @return Pointer to the dequeued packet, or nullptr if no packet is available or dequeuing fails.
  */
 Ptr<Packet> DiffServ::DoDequeue() {
-    auto [index, dpacket] = Schedule();
-    if (dpacket && index < q_class.size()) {
-        std::cout << "DiffServ::DoDequeue: Dequeuing packet from queue " << index << std::endl;
-        Ptr<Packet> packet = q_class[index]->Dequeue();
-        if (!packet) {
-            std::cout << "DiffServ::DoDequeue: Dequeue returned nullptr for queue " << index << std::endl;
+    while (true) {
+        auto [index, dpacket] = PendingDecision();
+        InvalidateDecision();
+        if (!dpacket || index >= q_class.size()) {
+            NS_LOG_LOGIC("No packet to dequeue (index=" << index
+                         << ", dpacket=" << (dpacket ? "valid" : "nullptr") << ")");
+            return nullptr;
         }
-        return packet;
+        NS_LOG_LOGIC("Dequeuing packet from queue " << index);
+        PacketDescriptor descriptor;
+        Ptr<Packet> packet = q_class[index]->Dequeue(&descriptor);
+        if (packet) {
+            bufferPool.Release(index, descriptor.size);
+            Queue<Packet>::DoDequeue(positions[index].Pop());
+        }
+        if (q_class[index]->IsShaped() && !q_class[index]->IsEmpty()) {
+            Park(index);
+        }
+        NotifyDequeued(index, packet ? descriptor.size : 0);
+        if (packet) {
+            tracer.Record(EventTracer::DEQUEUE, index, descriptor.size);
+            return packet;
+        }
+        NS_LOG_LOGIC("AQM of queue " << index << " dropped all its packets");
     }
-    std::cout << "DiffServ::DoDequeue: No packet to dequeue (index=" << index 
-              << ", dpacket=" << (dpacket ? "valid" : "nullptr") << ")" << std::endl;
-    return nullptr;
 }
 
 Ptr<Packet> DiffServ::Remove() {
     return DoRemove();
 }
 
+/**
+ * @brief Removes the packet the scheduler would send next and drops it.
+ *
+ * The packet leaves the Queue<Packet> base through its Remove path, which counts it as
+ * dropped after dequeue.
+ *
+ * @return Pointer to the removed packet, or nullptr if no packet is available.
+ */
 Ptr<Packet> DiffServ::DoRemove() {
-    auto [index, rpacket] = Schedule();
+    auto [index, rpacket] = PendingDecision();
+    InvalidateDecision();
     if (rpacket && index < q_class.size()) {
-        std::cout << "DiffServ::DoRemove: Removing packet from queue " << index << std::endl;
-        return q_class[index]->Remove();
+        NS_LOG_LOGIC("Removing packet from queue " << index);
+        PacketDescriptor descriptor;
+        Ptr<Packet> packet = q_class[index]->Remove(&descriptor);
+        if (packet) {
+            bufferPool.Release(index, descriptor.size);
+            tracer.Record(EventTracer::DROP, index, descriptor.size);
+            Queue<Packet>::DoRemove(positions[index].Pop());
+            if (q_class[index]->IsShaped() && !q_class[index]->IsEmpty()) {
+                Park(index);
+            }
+            NotifyDequeued(index, descriptor.size);
+        }
+        return packet;
     }
-    std::cout << "DiffServ::DoRemove: No packet to remove (index=" << index 
-              << ", rpacket=" << (rpacket ? "valid" : "nullptr") << ")" << std::endl;
+    NS_LOG_LOGIC("No packet to remove (index=" << index
+                 << ", rpacket=" << (rpacket ? "valid" : "nullptr") << ")");
     return nullptr;
 }
 
+/**
+ * @brief Accounts for a queued packet its class's AQM dropped while dequeuing.
+ *
+ * Releases its buffer and removes it from the Queue<Packet> base as dropped after dequeue.
+ *
+ * @param p The dropped packet.
+ * @param descriptor Its descriptor.
+ */
+void DiffServ::DropQueued(Ptr<Packet> p, const PacketDescriptor& descriptor) {
+    NS_LOG_LOGIC("AQM of queue " << descriptor.classIndex << " dropped a packet");
+    bufferPool.Release(descriptor.classIndex, descriptor.size);
+    tracer.Record(EventTracer::DROP, descriptor.classIndex, descriptor.size);
+    Queue<Packet>::DoRemove(positions[descriptor.classIndex].Pop());
+}
+
+/**
+ * @brief Returns the packet the next Dequeue() will return, without copying it.
+ *
+ * The scheduling decision is computed once and kept until Dequeue() or Remove() commits
+ * it, or an arrival preempts it, so Peek() followed by Dequeue() runs Schedule() once.
+ *
+ * @return The head packet of the scheduled queue, or nullptr if all queues are empty.
+ */
 Ptr<const Packet> DiffServ::Peek() const {
-    auto [index, next_packet] = const_cast<DiffServ*>(this)->Schedule();
+    // Caching the decision is not observable: Dequeue() commits the same one.
+    auto [index, next_packet] = const_cast<DiffServ*>(this)->PendingDecision();
     if (next_packet) {
-        std::cout << "DiffServ::DoPeek: Peeking packet from queue " << index << std::endl;
-        return next_packet->Copy();
+        NS_LOG_LOGIC("Peeking packet from queue " << index);
+        return next_packet;
     }
-    std::cout << "DiffServ::DoPeek: No packet to peek (index=" << index 
-              << ", next_packet=" << (next_packet ? "valid" : "nullptr") << ")" << std::endl;
+    NS_LOG_LOGIC("No packet to peek (index=" << index
+                 << ", next_packet=" << (next_packet ? "valid" : "nullptr") << ")");
     return nullptr;
 }
 
+/**
+ * @brief Returns the cached scheduling decision, running Schedule() if there is none.
+ */
+std::pair<uint32_t, Ptr<const Packet>> DiffServ::PendingDecision() {
+    if (!hasDecision) {
+        decision = Schedule();
+        hasDecision = true;
+    }
+    return decision;
+}
+
+/**
+ * @brief Tells the scheduler a class became backlogged, dropping the pending decision if
+ * the arrival preempts it.
+ *
+ * @param index Index of the traffic class.
+ * @param size Size of the packet that arrived, or of the class's head packet.
+ */
+void DiffServ::Announce(uint32_t index, uint32_t size) {
+    NotifyEnqueued(index, size);
+    if (hasDecision && (!decision.second || Preempts(index, decision.first))) {
+        InvalidateDecision();
+    }
+}
+
+/**
+ * @brief Exchanges the scheduler's own state with that of a staged scheduler of the same type.
+ *
+ * Called by Reload() after the classes were swapped and before the backlog is moved, so
+ * the state taken over from the staged scheduler is that of its configuration with no
+ * packet queued. Schedulers that keep per-class or configuration state override this;
+ * the default does nothing.
+ *
+ * @param staged The scheduler the new configuration was read into.
+ */
+void DiffServ::SwapSchedulerState(DiffServ& staged) {
+}
+
+/**
+ * @brief Drops the cached scheduling decision, so the next Peek() or Dequeue() reschedules.
+ */
+void DiffServ::InvalidateDecision() {
+    hasDecision = false;
+    decision = {q_class.size(), nullptr};
+}
+
+/**
+ * @brief Tells whether a packet arriving in a class can change the pending decision.
+ *
+ * Called after each enqueue while a decision is pending; arrivals in an otherwise empty
+ * scheduler always invalidate it. The default is conservative and always returns true.
+ *
+ * @param arrival Index of the class the packet was enqueued in.
+ * @param pending Index of the class chosen by the pending decision.
+ * @return True if the decision must be recomputed.
+ */
+bool DiffServ::Preempts(uint32_t arrival, uint32_t pending) const {
+    return true;
+}
+
 /**
  * @brief Adds a traffic class queue to the DiffServ system.
  *
- * Appends the provided traffic class to the list of queues and logs the updated queue count.
+ * Appends the provided traffic class to the list of queues, subscribes to changes of its
+ * filters and logs the updated queue count. The compiled classifier is invalidated, and
+ * MaxSize, unless it was set, grows by the class's packet limit.
  *
  * @param trafficClass Pointer to the traffic class to be added.
  */
 void DiffServ::AddQueue(Ptr<TrafficClass> trafficClass) {
     q_class.push_back(trafficClass);
-    std::cout << "DiffServ::AddQueue: Added queue, total queues=" << q_class.size() << std::endl;
+    positions.emplace_back();
+    positions.back().Reserve(trafficClass->GetMaxPackets());
+    parked.resize(q_class.size(), false);
+    bufferPool.AddClass();
+    BindClass(trafficClass);
+    UpdateMaxSize();
+    InvalidateClassifier();
+    InvalidateDecision();
+    NS_LOG_INFO("Added queue, total queues=" << q_class.size());
+}
+
+/**
+ * @brief Subscribes to a class's filter changes and AQM drops, and hands it the mark callbacks.
+ */
+void DiffServ::BindClass(Ptr<TrafficClass> trafficClass) {
+    trafficClass->SetFiltersChangedCallback(MakeCallback(&DiffServ::InvalidateClassifier, this));
+    trafficClass->SetDropCallback(MakeCallback(&DiffServ::DropQueued, this));
+    if (!markDscp.IsNull()) {
+        trafficClass->SetMarkCallbacks(markDscp, markEcnCe);
+    }
+}
+
+/**
+ * @brief Sets MaxSize to the sum of the class packet limits, unless it was set explicitly.
+ *
+ * MaxSize counts as set once it differs from both its attribute default and the value
+ * this function last gave it, so a limit from SetMaxSize() or the attribute is kept
+ * across AddQueue() and Reload(). A class limit changed after AddQueue() is not picked up.
+ */
+void DiffServ::UpdateMaxSize() {
+    QueueSize current = GetMaxSize();
+    if (current != autoMaxSize && current != GetDefaultMaxSize(GetInstanceTypeId())) {
+        return;
+    }
+    uint64_t total = 0;
+    for (Ptr<TrafficClass> trafficClass : q_class) {
+        total += trafficClass->GetMaxPackets();
+    }
+    autoMaxSize = QueueSize(QueueSizeUnit::PACKETS, static_cast<uint32_t>(std::min<uint64_t>(total, UINT32_MAX)));
+    SetMaxSize(autoMaxSize);
+}
+
+/**
+ * @brief Replaces how the classes rewrite the DSCP and ECN fields of queued packets,
+ * for the current classes and those added later.
+ *
+ * @param dscp Sets the DSCP of a packet the policer remarks.
+ * @param ecnCe Sets ECN CE on a packet the AQM marks; returns false if it is not ECN-capable.
+ */
+void DiffServ::SetMarkCallbacks(Callback<bool, Ptr<Packet>, uint8_t> dscp, Callback<bool, Ptr<Packet>> ecnCe) {
+    markDscp = dscp;
+    markEcnCe = ecnCe;
+    for (Ptr<TrafficClass> trafficClass : q_class) {
+        trafficClass->SetMarkCallbacks(dscp, ecnCe);
+    }
 }
 
 std::vector<Ptr<TrafficClass>> DiffServ::GetQueues() const {
     return q_class;
 }
 
+/**
+ * @brief Replaces the configuration with the one in a config file, while packets are queued.
+ *
+ * The file is read into a fresh scheduler of the same type, so its classes, filters,
+ * compiled classifier and shared buffer are built off to the side, and a file that
+ * cannot be read or defines no class leaves the queue untouched. The new configuration
+ * is then swapped in within the calling event: the old classes are emptied, and their
+ * packets, in arrival order, are either reclassified into the new classes or dropped, as
+ * the policy says. A migrated packet keeps its arrival time and its place in the
+ * Queue<Packet> base, and bypasses the new class's policer and AQM; one that matches no
+ * new class or does not fit in it is dropped after dequeue. Attributes, traces and
+ * callbacks of the queue carry over; the buffer size and alpha carry over unless the
+ * file sets them, and MaxSize follows the new class limits unless it was set. Nothing is
+ * checked on the per-packet path for a reload to happen.
+ *
+ * @param filename The config file, in the format ReadConfigFile() reads.
+ * @param policy What to do with the packets queued under the old configuration.
+ * @return True if the new configuration is in place.
+ */
+bool DiffServ::Reload(const std::string& filename, ReloadPolicy policy) {
+    ObjectFactory factory;
+    factory.SetTypeId(GetInstanceTypeId());
+    Ptr<DiffServ> staged = factory.Create<DiffServ>();
+    staged->SetBufferSize(GetBufferSize());
+    staged->SetBufferAlpha(GetBufferAlpha());
+    if (!staged->ReadConfigFile(filename) || staged->q_class.empty()) {
+        NS_LOG_ERROR("Config file " << filename << " not reloaded, the current configuration stays");
+        return false;
+    }
+
+    struct Queued {
+        Ptr<Packet> packet;
+        PacketDescriptor descriptor;
+        Iterator position;
+    };
+    std::vector<Queued> backlog;
+    for (uint32_t index = 0; index < q_class.size(); ++index) {
+        PacketDescriptor descriptor;
+        while (Ptr<Packet> p = q_class[index]->Remove(&descriptor)) {
+            backlog.push_back({p, descriptor, positions[index].Pop()});
+        }
+    }
+    std::stable_sort(backlog.begin(), backlog.end(), [](const Queued& a, const Queued& b) {
+        return a.descriptor.arrival < b.descriptor.arrival;
+    });
+    for (uint32_t index = 0; index < parked.size(); ++index) {
+        if (parked[index]) {
+            shaperWheel.Cancel(index);
+        }
+    }
+
+    std::swap(q_class, staged->q_class);
+    std::swap(positions, staged->positions);
+    std::swap(classifier, staged->classifier);
+    std::swap(ruleTable, staged->ruleTable);
+    std::swap(bufferPool, staged->bufferPool);
+    SwapSchedulerState(*staged);
+    parked.assign(q_class.size(), false);
+    flowCache.Invalidate();
+    for (Ptr<TrafficClass> trafficClass : q_class) {
+        BindClass(trafficClass);
+    }
+    InvalidateDecision();
+    staged->Dispose();
+
+    for (auto& [p, descriptor, position] : backlog) {
+        Migrate(p, descriptor, position, policy);
+    }
+    UpdateMaxSize();
+    NS_LOG_INFO("Reloaded " << filename << ": " << q_class.size() << " queues, "
+                << backlog.size() << " queued packets " << (policy == MIGRATE ? "migrated" : "flushed"));
+    return true;
+}
+
+/**
+ * @brief Schedules Reload() of a config file, to model a policy change during a simulation.
+ *
+ * @param delay Time from now at which the configuration changes.
+ * @param filename The config file.
+ * @param policy What to do with the packets queued at that time.
+ * @return The event, which can be cancelled.
+ */
+EventId DiffServ::ScheduleReload(Time delay, const std::string& filename, ReloadPolicy policy) {
+    return Simulator::Schedule(delay, &DiffServ::ReloadEvent, this, filename, policy);
+}
+
+void DiffServ::ReloadEvent(std::string filename, ReloadPolicy policy) {
+    if (!Reload(filename, policy)) {
+        NS_LOG_WARN("Scheduled reload of " << filename << " failed");
+    }
+}
+
+/**
+ * @brief Sets how Reload() recovers the flow key of a queued packet to reclassify it.
+ *
+ * Needed when the queued packets do not start with the PPP and IP headers
+ * FlowKey::Extract() parses, as in DiffServQueueDisc.
+ *
+ * @param cb Returns the flow key of a queued packet.
+ */
+void DiffServ::SetFlowKeyCallback(Callback<FlowKey, Ptr<const Packet>> cb) {
+    flowKeyOf = cb;
+}
+
+/**
+ * @brief Moves a packet queued before a reload into its class under the new configuration.
+ *
+ * @param p The packet, already taken out of its old class.
+ * @param descriptor Its descriptor.
+ * @param position Its entry in the Queue<Packet> list.
+ * @param policy MIGRATE to reclassify the packet, FLUSH to drop it.
+ */
+void DiffServ::Migrate(Ptr<Packet> p, PacketDescriptor descriptor, Iterator position, ReloadPolicy policy) {
+    uint32_t index = q_class.size();
+    if (policy == MIGRATE) {
+        index = Classify(flowKeyOf.IsNull() ? FlowKey::Extract(p) : flowKeyOf(p));
+    }
+    if (index < q_class.size() && bufferPool.Admit(index, descriptor.size)) {
+        descriptor.classIndex = index;
+        bool shaped = q_class[index]->IsShaped();
+        bool wasEmpty = shaped && q_class[index]->IsEmpty();
+        if (q_class[index]->Adopt(p, descriptor)) {
+            positions[index].Push(position);
+            if (!(shaped && (parked[index] || (wasEmpty && Park(index))))) {
+                Announce(index, descriptor.size);
+            }
+            return;
+        }
+        bufferPool.Release(index, descriptor.size);
+    }
+    NS_LOG_LOGIC("Packet queued before the reload dropped");
+    tracer.Record(EventTracer::DROP, index, descriptor.size);
+    Queue<Packet>::DoRemove(position);
+}
+
+/**
+ * @brief Compiles the filters of all traffic classes into a single lookup structure.
+ *
+ * Called once the configuration has been read. Later changes to the rule set invalidate
+ * the compiled index, and the next classification recompiles it.
+ */
+void DiffServ::CompileClassifier() {
+    classifier.Build(q_class);
+    NS_LOG_INFO("Compiled filters of " << q_class.size() << " queues");
+}
+
+/**
+ * @brief Discards the compiled classifier and every cached classification result.
+ *
+ * Called whenever the rule set changes: a queue is added or a filter is added to a queue.
+ */
+void DiffServ::InvalidateClassifier() {
+    classifier.Clear();
+    ruleTable.Clear();
+    flowCache.Invalidate();
+}
+
+/**
+ * @brief Classifies a burst of packets in one call.
+ *
+ * Small rule sets are evaluated with the SIMD kernels of a columnar copy of the rules,
+ * which compare a block of rules against the whole burst at once. Beyond
+ * BATCH_SCAN_MAX_ROWS rules (or with filter elements the columnar table cannot express)
+ * the compiled classifier is cheaper per packet and is used instead. Neither path
+ * consults or fills the flow cache.
+ *
+ * @param keys Flow keys of the packets to classify.
+ * @param out Receives the queue index of each packet, or q_class.size() if no queue
+ *            matches. Must be at least as long as keys.
+ */
+void DiffServ::ClassifyBatch(std::span<const FlowKey> keys, std::span<uint32_t> out) {
+    NS_ASSERT_MSG(out.size() >= keys.size(), "ClassifyBatch: output span too short");
+    if (!ruleTable.IsBuilt()) {
+        ruleTable.Build(q_class);
+    }
+    if (ruleTable.IsComplete() && ruleTable.GetRowCount() <= BATCH_SCAN_MAX_ROWS) {
+        ruleTable.Classify(keys, out);
+        return;
+    }
+    for (size_t i = 0; i < keys.size(); ++i) {
+        out[i] = LookupClass(keys[i]);
+    }
+}
+
+void DiffServ::SetFlowCacheCapacity(uint32_t entries) {
+    flowCache.SetCapacity(entries);
+}
+
+uint32_t DiffServ::GetFlowCacheCapacity() const {
+    return flowCache.GetCapacity();
+}
+
+void DiffServ::SetFlowCachePolicy(FlowCache::Policy policy) {
+    flowCache.SetPolicy(policy);
+}
+
+FlowCache::Policy DiffServ::GetFlowCachePolicy() const {
+    return flowCache.GetPolicy();
+}
+
+/**
+ * @brief Gives access to the flow cache, e.g. to read its hit, miss and eviction counters.
+ */
+const FlowCache& DiffServ::GetFlowCache() const {
+    return flowCache;
+}
+
+/**
+ * @brief Finds the first traffic class whose filters accept the packet.
+ *
+ * Uses the compiled classifier, recompiling it first if the rule set changed since the
+ * last compilation.
+ *
+ * @param key Header fields extracted from the packet to be classified.
+ * @return The index of the matching queue, or q_class.size() if no queue matches.
+ */
+uint32_t DiffServ::LookupClass(const FlowKey& key) {
+    if (!classifier.IsBuilt()) {
+        CompileClassifier();
+    }
+    return classifier.Lookup(key);
+}
+
+/**
+ * @brief Called after a packet was enqueued in a traffic class.
+ *
+ * Schedulers that keep per-class state, such as a list of backlogged classes, override
+ * this instead of rescanning the classes in Schedule(). The default does nothing.
+ *
+ * @param index Index of the traffic class.
+ * @param size Size of the packet, in bytes.
+ */
+void DiffServ::NotifyEnqueued(uint32_t index, uint32_t size) {
+}
+
+/**
+ * @brief Called after the packet chosen by Schedule() was taken out of its traffic class.
+ *
+ * The default does nothing.
+ *
+ * @param index Index of the traffic class.
+ * @param size Size of the packet, in bytes.
+ */
+void DiffServ::NotifyDequeued(uint32_t index, uint32_t size) {
+}
+
+/**
+ * @brief Starts writing a binary event trace of this queue's internals.
+ *
+ * Records enqueue, classification, drop, scheduling, deficit and dequeue events; the
+ * file can be converted to CSV with the trace-decoder tool.
+ *
+ * @param filename The trace file to write.
+ * @param bufferRecords Number of records buffered in memory between writes.
+ * @return True if the file could be opened.
+ */
+bool DiffServ::EnableEventTrace(const std::string& filename, uint32_t bufferRecords) {
+    return tracer.Open(filename, bufferRecords);
+}
+
+void DiffServ::DisableEventTrace() {
+    tracer.Close();
+}
+
+/**
+ * @brief Tells whether a class has packets the scheduler may serve now.
+ *
+ * Schedulers call this from NotifyDequeued() to decide whether the class stays active:
+ * a shaped class whose next packet exceeds its shaper is not backlogged until the timer
+ * wheel announces it again through NotifyEnqueued().
+ *
+ * @param index Index of the traffic class.
+ * @return True if the class is non-empty and not waiting for shaper tokens.
+ */
+bool DiffServ::IsBacklogged(uint32_t index) const {
+    return !parked[index] && !q_class[index]->IsEmpty();
+}
+
+/**
+ * @brief Sets the granularity of shaper wakeups.
+ *
+ * Parked classes are released on the first tick boundary after their head packet
+ * conforms, and all classes released on the same tick share one simulator event.
+ * Cannot change while classes are parked.
+ *
+ * @param tick The tick length.
+ */
+void DiffServ::SetShaperTick(Time tick) {
+    NS_ABORT_MSG_IF(!tick.IsStrictlyPositive(), "ShaperTick must be positive");
+    NS_ABORT_MSG_IF(shaperWheel.GetPendingCount() > 0, "Cannot change ShaperTick while classes are parked");
+    shaperTick = tick;
+}
+
+Time DiffServ::GetShaperTick() const {
+    return shaperTick;
+}
+
+/**
+ * @brief Registers a callback invoked when shaped classes become eligible again.
+ *
+ * Dequeue() returns nothing while every backlogged class waits for shaper tokens, so
+ * the owner of the queue uses this to resume pulling packets.
+ *
+ * @param cb The callback to invoke.
+ */
+void DiffServ::SetWakeupCallback(Callback<void> cb) {
+    wakeup = cb;
+}
+
+/**
+ * @brief Parks a shaped class on the timer wheel if its head packet exceeds the shaper.
+ *
+ * @param index Index of a non-empty shaped traffic class.
+ * @return True if the class was parked, false if its head packet conforms.
+ */
+bool DiffServ::Park(uint32_t index) {
+    Time eligible = q_class[index]->GetEligibleTime();
+    if (eligible <= Simulator::Now()) {
+        return false;
+    }
+    int64_t step = shaperTick.GetTimeStep();
+    uint64_t tick = (eligible.GetTimeStep() + step - 1) / step;
+    parked[index] = true;
+    shaperWheel.Schedule(index, tick);
+    NS_LOG_LOGIC("Queue " << index << " parked until " << eligible.GetSeconds() << "s");
+    ArmShaperTimer();
+    return true;
+}
+
+/**
+ * @brief Makes sure a simulator event is pending for the timer wheel's next tick.
+ */
+void DiffServ::ArmShaperTimer() {
+    uint64_t next = shaperWheel.GetNextTick();
+    if (next == TimerWheel::NO_TICK || (shaperEvent.IsPending() && shaperEventTick <= next)) {
+        return;
+    }
+    shaperEvent.Cancel();
+    Time now = Simulator::Now();
+    Time at = shaperTick * static_cast<int64_t>(next);
+    shaperEvent = Simulator::Schedule(at > now ? at - now : Seconds(0), &DiffServ::ShaperTimerExpired, this);
+    shaperEventTick = next;
+}
+
+/**
+ * @brief Releases the classes whose shaper wakeup is due and announces them to the scheduler.
+ */
+void DiffServ::ShaperTimerExpired() {
+    std::vector<uint32_t> expired;
+    shaperWheel.Advance(Simulator::Now().GetTimeStep() / shaperTick.GetTimeStep(), expired);
+    bool released = false;
+    for (uint32_t index : expired) {
+        parked[index] = false;
+        if (!q_class[index]->IsEmpty() && !Park(index)) {
+            NS_LOG_LOGIC("Queue " << index << " released by the shaper");
+            Announce(index, q_class[index]->PeekDescriptor()->size);
+            released = true;
+        }
+    }
+    ArmShaperTimer();
+    if (released && !wakeup.IsNull()) {
+        wakeup();
+    }
+}
+
+/**
+ * @brief Sets the size of the buffer shared by all classes.
+ *
+ * @param bytes Buffer size, in bytes; zero disables byte accounting, leaving only the
+ *              per-class packet limits.
+ */
+void DiffServ::SetBufferSize(uint64_t bytes) {
+    bufferPool.SetSize(bytes);
+    NS_LOG_INFO("Set shared buffer size=" << bytes << " bytes");
+}
+
+uint64_t DiffServ::GetBufferSize() const {
+    return bufferPool.GetSize();
+}
+
+void DiffServ::SetBufferAlpha(double alpha) {
+    bufferPool.SetDefaultAlpha(alpha);
+}
+
+double DiffServ::GetBufferAlpha() const {
+    return bufferPool.GetDefaultAlpha();
+}
+
+/**
+ * @brief Reserves part of the shared buffer for a class and optionally sets its alpha.
+ *
+ * @param index Index of the traffic class.
+ * @param bytes Bytes the class can always fill, whatever the other classes hold.
+ * @param alpha The class's share of the free shared buffer; negative keeps the default.
+ */
+void DiffServ::SetBufferGuarantee(uint32_t index, uint64_t bytes, double alpha) {
+    NS_ABORT_MSG_IF(index >= q_class.size(), "Invalid queue index " << index);
+    bufferPool.SetGuarantee(index, bytes);
+    bufferPool.SetAlpha(index, alpha);
+    NS_LOG_INFO("Reserved " << bytes << " bytes for queue " << index << ", alpha=" << alpha);
+}
+
+/**
+ * @brief Gives access to the shared buffer, e.g. to read per-class occupancy and drops.
+ */
+const SharedBufferPool& DiffServ::GetBufferPool() const {
+    return bufferPool;
+}
+
+/**
+ * @brief Writes the p50, p99 and p99.9 of every class's sojourn time and time-weighted
+ * queue length, one line per class.
+ *
+ * @param os The stream to write to.
+ */
+void DiffServ::DumpHistograms(std::ostream& os) const {
+    for (uint32_t i = 0; i < q_class.size(); ++i) {
+        const LogHistogram& sojourn = q_class[i]->GetSojournHistogram();
+        const LogHistogram& packets = q_class[i]->GetPacketOccupancyHistogram();
+        const LogHistogram& bytes = q_class[i]->GetByteOccupancyHistogram();
+        os << "queue " << i << ": sojourn(ms)";
+        for (double percentile : {50.0, 99.0, 99.9}) {
+            os << " p" << percentile << "=" << sojourn.GetPercentile(percentile) / 1e6;
+        }
+        os << " max=" << sojourn.GetMax() / 1e6 << " | packets";
+        for (double percentile : {50.0, 99.0, 99.9}) {
+            os << " p" << percentile << "=" << packets.GetPercentile(percentile);
+        }
+        os << " | bytes";
+        for (double percentile : {50.0, 99.0, 99.9}) {
+            os << " p" << percentile << "=" << bytes.GetPercentile(percentile);
+        }
+        os << "\n";
+    }
+}
+
+/**
+ * @brief Reads the traffic classes, filters and options from a config file.
+ *
+ * Each line goes to ParseConfigLine(). The first malformed line stops the read with an
+ * error naming the file and line, and the queue must then be discarded: the lines
+ * before it are already applied. The classifier is compiled once all rules are in.
+ *
+ * @param filename The config file.
+ * @return True if every line of the file was valid.
+ */
+bool DiffServ::ReadConfigFile(std::string filename) {
+    ConfigParser parser;
+    if (parser.Open(filename)) {
+        while (parser.NextLine() && ParseConfigLine(parser)) {
+        }
+    }
+    if (parser.HasError()) {
+        NS_LOG_ERROR(parser.GetError());
+        return false;
+    }
+    CompileClassifier();
+    NS_LOG_INFO("Configured " << q_class.size() << " queues from " << filename);
+    return true;
+}
+
+/**
+ * @brief Applies one line of a config file.
+ *
+ * Handles the lines shared by the scheduler config files; schedulers override this to
+ * add their "queue" line and fall back to it for the others:
+ *
+ *     filter <queueId> <type> <value> [<type> <value>...]
+ *     shape <queueId> <rate> <burstBytes>
+ *     police <queueId> <rate> <burstBytes> [drop | remark <dscp>]
+ *     buffer <bytes> [alpha]
+ *     reserve <queueId> <bytes> [alpha]
+ *     aqm <queueId> <codel | pie | red> [parameters...] [ecn]
+ *
+ * A filter matches packets that satisfy all of its conditions; a queue with several
+ * filter lines matches packets that satisfy any of them. Filter types are listed at
+ * CreateFilterElement(), rates use the DataRate syntax, e.g. "2Mbps", and AQM
+ * parameters are listed at CreateAqm(). Queue ids must name a queue declared above.
+ *
+ * @param line The line, split into words.
+ * @return True if the line was applied; otherwise the error is recorded on line.
+ */
+bool DiffServ::ParseConfigLine(ConfigParser& line) {
+    std::string_view keyword = line.GetWord(0);
+    uint32_t queueId;
+    if (keyword == "filter") {
+        return ParseFilter(line);
+    }
+    if (keyword == "buffer") {
+        uint64_t bytes;
+        double alpha;
+        if (!line.ExpectWords(2, 3) || !line.GetUint64(1, bytes)
+            || (line.GetNWords() == 3 && !line.GetDouble(2, alpha))) {
+            return false;
+        }
+        SetBufferSize(bytes);
+        if (line.GetNWords() == 3) {
+            SetBufferAlpha(alpha);
+        }
+        return true;
+    }
+    if (keyword == "reserve") {
+        uint64_t bytes;
+        double alpha = -1;
+        if (!line.ExpectWords(3, 4) || !ParseQueueIndex(line, 1, queueId) || !line.GetUint64(2, bytes)
+            || (line.GetNWords() == 4 && !line.GetDouble(3, alpha))) {
+            return false;
+        }
+        SetBufferGuarantee(queueId, bytes, alpha);
+        return true;
+    }
+    if (keyword == "aqm") {
+        if (!line.ExpectWords(3, SIZE_MAX) || !ParseQueueIndex(line, 1, queueId)) {
+            return false;
+        }
+        bool ecn = line.GetNWords() > 3 && line.GetWord(line.GetNWords() - 1) == "ecn";
+        std::vector<double> params;
+        for (size_t i = 3; i < line.GetNWords() - (ecn ? 1 : 0); ++i) {
+            double param;
+            if (!line.GetDouble(i, param)) {
+                return false;
+            }
+            params.push_back(param);
+        }
+        std::string error;
+        Aqm* aqm = CreateAqm(std::string(line.GetWord(2)), params, ecn, error);
+        if (!aqm) {
+            return line.Error(error);
+        }
+        q_class[queueId]->SetAqm(aqm);
+        return true;
+    }
+    if (keyword != "shape" && keyword != "police") {
+        return line.Error("unknown keyword '" + std::string(keyword) + "'");
+    }
+
+    uint32_t burst;
+    DataRate rate;
+    if (!line.ExpectWords(4, keyword == "police" ? 6 : 4) || !ParseQueueIndex(line, 1, queueId)
+        || !line.GetUint32(3, burst)) {
+        return false;
+    }
+    std::istringstream rateWord{std::string(line.GetWord(2))};
+    if (!(rateWord >> rate)) {
+        return line.Error("invalid rate '" + std::string(line.GetWord(2)) + "'");
+    }
+    if (keyword == "shape") {
+        q_class[queueId]->SetShaper(rate, burst);
+        return true;
+    }
+    std::string_view action = line.GetWord(4);
+    uint32_t dscp;
+    if (action == "remark" && line.ExpectWords(6, 6)) {
+        if (!line.GetUint32(5, dscp)) {
+            return false;
+        }
+        if (dscp > 63) {
+            return line.Error("remark DSCP must be 0-63");
+        }
+        q_class[queueId]->SetPolicer(rate, burst, TrafficClass::REMARK, static_cast<uint8_t>(dscp));
+    } else if ((action.empty() || action == "drop") && line.ExpectWords(4, 5)) {
+        q_class[queueId]->SetPolicer(rate, burst, TrafficClass::DROP);
+    } else {
+        return line.Error("invalid policer action '" + std::string(action) + "'");
+    }
+    return true;
+}
+
+/**
+ * @brief Adds a filter line's conditions, ANDed in one Filter, to its queue.
+ */
+bool DiffServ::ParseFilter(ConfigParser& line) {
+    uint32_t queueId;
+    if (!line.ExpectWords(4, SIZE_MAX) || !ParseQueueIndex(line, 1, queueId)) {
+        return false;
+    }
+    if (line.GetNWords() % 2 != 0) {
+        return line.Error("filter conditions come in <type> <value> pairs");
+    }
+    Filter* filter = new Filter();
+    for (size_t i = 2; i < line.GetNWords(); i += 2) {
+        FilterElement* element = CreateFilterElement(line.GetWord(i), line.GetWord(i + 1));
+        if (!element) {
+            delete filter;
+            return line.Error("invalid filter condition '" + std::string(line.GetWord(i)) + " "
+                              + std::string(line.GetWord(i + 1)) + "'");
+        }
+        filter->AddElement(element);
+    }
+    q_class[queueId]->AddFilter(filter);
+    return true;
+}
+
+/**
+ * @brief Checks that a "queue" line declares the next queue: ids count up from 0 in
+ * declaration order, which is the order filters and options refer to them by.
+ *
+ * @param line The line.
+ * @param queueId The id the line declares.
+ * @return True if the id is the next one; otherwise the error is recorded on line.
+ */
+bool DiffServ::CheckNewQueueId(ConfigParser& line, uint32_t queueId) {
+    if (queueId != q_class.size()) {
+        return line.Error("queue " + std::to_string(queueId) + " declared, expected queue "
+                          + std::to_string(q_class.size()));
+    }
+    return true;
+}
+
+/**
+ * @brief Declares a queue from a line of the flat schedulers' form
+ *
+ *     queue <id> <parameter> <maxPackets>
+ *
+ * where the parameter means what the scheduler makes of it, a priority or a weight.
+ *
+ * @param line The line.
+ * @param setParameter The TrafficClass setter the parameter is passed to.
+ * @return True if the queue was added; otherwise the error is recorded on line.
+ */
+bool DiffServ::ParseQueueLine(ConfigParser& line, void (TrafficClass::*setParameter)(uint32_t)) {
+    uint32_t queueId, parameter, maxPackets;
+    if (!line.ExpectWords(4, 4) || !line.GetUint32(1, queueId) || !line.GetUint32(2, parameter)
+        || !line.GetUint32(3, maxPackets) || !CheckNewQueueId(line, queueId)) {
+        return false;
+    }
+    Ptr<TrafficClass> tc = CreateObject<TrafficClass>();
+    ((*tc).*setParameter)(parameter);
+    tc->SetMaxPackets(maxPackets);
+    AddQueue(tc);
+    return true;
+}
+
+/**
+ * @brief Reads a word naming a queue declared earlier in the file.
+ */
+bool DiffServ::ParseQueueIndex(ConfigParser& line, size_t index, uint32_t& queueId) {
+    if (!line.GetUint32(index, queueId)) {
+        return false;
+    }
+    if (queueId >= q_class.size()) {
+        return line.Error("queue " + std::to_string(queueId) + " is not declared");
+    }
+    return true;
+}
+
+void DiffServ::DoDispose() {
+    shaperEvent.Cancel();
+    tracer.Close();
+    positions.clear();
+    Queue<Packet>::DoDispose();
+}
+
 } // namespace ns3
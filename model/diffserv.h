@@ -3,6 +3,20 @@
 
 #include "ns3/queue.h"
 #include "traffic-class.h"
+#include "flow-key.h"
+#include "classifier-index.h"
+#include "flow-cache.h"
+#include "rule-table.h"
+#include "event-tracer.h"
+#include "timer-wheel.h"
+#include "shared-buffer-pool.h"
+#include "ring-buffer.h"
+#include "config-parser.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include <ostream>
+#include <string>
+#include <span>
 #include <vector>
 #include <utility>
 
@@ -10,24 +24,112 @@ namespace ns3 {
 
 class DiffServ : public Queue<Packet> {
 public:
+    /** What Reload() does with the packets queued under the old configuration. */
+    enum ReloadPolicy {
+        MIGRATE,   // reclassify them under the new rules
+        FLUSH      // drop them
+    };
+
+    static const uint32_t BATCH_SCAN_MAX_ROWS = 1024;  // larger rule tables are not scanned by ClassifyBatch()
+
+    static TypeId GetTypeId(void);
     DiffServ();
 
     bool Enqueue(Ptr<Packet> p) override;
+    bool Enqueue(Ptr<Packet> p, const FlowKey& key);
     Ptr<Packet> Dequeue() override;
     Ptr<Packet> Remove() override;
     Ptr<const Packet> Peek() const override;
-    virtual uint32_t Classify(Ptr<Packet> p) = 0;
+    virtual uint32_t Classify(const FlowKey& key) = 0;
+    void ClassifyBatch(std::span<const FlowKey> keys, std::span<uint32_t> out);
     virtual std::pair<uint32_t, Ptr<const Packet>> Schedule() = 0;
+    virtual bool ReadConfigFile(std::string filename);
+    bool Reload(const std::string& filename, ReloadPolicy policy = MIGRATE);
+    EventId ScheduleReload(Time delay, const std::string& filename, ReloadPolicy policy = MIGRATE);
+    void SetFlowKeyCallback(Callback<FlowKey, Ptr<const Packet>> cb);
     void AddQueue(Ptr<TrafficClass> q);
     std::vector<Ptr<TrafficClass>> GetQueues() const;
+    void SetMarkCallbacks(Callback<bool, Ptr<Packet>, uint8_t> dscp, Callback<bool, Ptr<Packet>> ecnCe);
+    void CompileClassifier();
+
+    void SetFlowCacheCapacity(uint32_t entries);
+    uint32_t GetFlowCacheCapacity() const;
+    void SetFlowCachePolicy(FlowCache::Policy policy);
+    FlowCache::Policy GetFlowCachePolicy() const;
+    const FlowCache& GetFlowCache() const;
+
+    bool EnableEventTrace(const std::string& filename,
+                          uint32_t bufferRecords = EventTracer::DEFAULT_BUFFER_RECORDS);
+    void DisableEventTrace();
+
+    void SetShaperTick(Time tick);
+    Time GetShaperTick() const;
+    void SetWakeupCallback(Callback<void> cb);
+
+    void SetBufferSize(uint64_t bytes);
+    uint64_t GetBufferSize() const;
+    void SetBufferAlpha(double alpha);
+    double GetBufferAlpha() const;
+    void SetBufferGuarantee(uint32_t index, uint64_t bytes, double alpha = -1);
+    const SharedBufferPool& GetBufferPool() const;
+
+    void DumpHistograms(std::ostream& os) const;
 
 protected:
+    void DoDispose() override;
     bool DoEnqueue(Ptr<Packet> p);
+    bool DoEnqueue(Ptr<Packet> p, const FlowKey& key);
     Ptr<Packet> DoDequeue();
     Ptr<Packet> DoRemove();
     Ptr<const Packet> DoPeek() const;
+    uint32_t LookupClass(const FlowKey& key);
+    void InvalidateClassifier();
+    virtual void NotifyEnqueued(uint32_t index, uint32_t size);
+    virtual void NotifyDequeued(uint32_t index, uint32_t size);
+    virtual bool Preempts(uint32_t arrival, uint32_t pending) const;
+    virtual void SwapSchedulerState(DiffServ& staged);
+    void InvalidateDecision();
+    bool IsBacklogged(uint32_t index) const;
+    virtual bool ParseConfigLine(ConfigParser& line);
+    bool CheckNewQueueId(ConfigParser& line, uint32_t queueId);
+    bool ParseQueueLine(ConfigParser& line, void (TrafficClass::*setParameter)(uint32_t));
 
     std::vector<Ptr<TrafficClass>> q_class;
+    EventTracer tracer;
+
+private:
+    std::pair<uint32_t, Ptr<const Packet>> PendingDecision();
+    void Announce(uint32_t index, uint32_t size);
+    bool ParseQueueIndex(ConfigParser& line, size_t index, uint32_t& queueId);
+    bool ParseFilter(ConfigParser& line);
+    void BindClass(Ptr<TrafficClass> trafficClass);
+    void UpdateMaxSize();
+    void Migrate(Ptr<Packet> p, PacketDescriptor descriptor, Iterator position, ReloadPolicy policy);
+    void ReloadEvent(std::string filename, ReloadPolicy policy);
+    void DropQueued(Ptr<Packet> p, const PacketDescriptor& descriptor);
+    bool Park(uint32_t index);
+    void ArmShaperTimer();
+    void ShaperTimerExpired();
+
+    bool hasDecision;                                 // decision holds the result of Schedule()
+    std::pair<uint32_t, Ptr<const Packet>> decision;  // not yet committed by Dequeue/Remove
+
+    ClassifierIndex classifier;
+    RuleTable ruleTable;
+    FlowCache flowCache;
+    SharedBufferPool bufferPool;
+    std::vector<RingBuffer<Iterator>> positions;  // Queue<Packet> list entries of each class's packets
+    QueueSize autoMaxSize;           // MaxSize as UpdateMaxSize() last set it
+
+    TimerWheel shaperWheel;          // wakes up classes waiting for shaper tokens
+    Time shaperTick;
+    EventId shaperEvent;
+    uint64_t shaperEventTick;
+    std::vector<uint8_t> parked;     // class is backlogged but its head packet exceeds the shaper
+    Callback<void> wakeup;
+    Callback<bool, Ptr<Packet>, uint8_t> markDscp;   // null: classes keep PacketMarker
+    Callback<bool, Ptr<Packet>> markEcnCe;
+    Callback<FlowKey, Ptr<const Packet>> flowKeyOf;  // null: FlowKey::Extract()
 };
 
 } // namespace ns3
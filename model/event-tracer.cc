@@ -0,0 +1,124 @@
+#include "event-tracer.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include <algorithm>
+#include <cstring>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("EventTracer");
+
+EventTracer::EventTracer() : m_enabled(false), m_head(0), m_count(0), m_recorded(0) {
+}
+
+EventTracer::~EventTracer() {
+    Close();
+}
+
+/**
+ * @brief Opens the trace file and starts recording.
+ *
+ * Any trace already open is closed first.
+ *
+ * @param filename The file to write; it is truncated.
+ * @param bufferRecords Number of records buffered in memory between writes.
+ * @return True if the file could be opened.
+ */
+bool EventTracer::Open(const std::string& filename, uint32_t bufferRecords) {
+    Close();
+    m_file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open()) {
+        NS_LOG_ERROR("Failed to open trace file: " << filename);
+        return false;
+    }
+    TraceFileHeader header;
+    std::memcpy(header.magic, "DSTRACE", 8);
+    header.version = FORMAT_VERSION;
+    header.recordSize = sizeof(TraceRecord);
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    m_ring.assign(std::max<uint32_t>(bufferRecords, 1), TraceRecord());
+    m_head = 0;
+    m_count = 0;
+    m_recorded = 0;
+    m_enabled = true;
+    NS_LOG_INFO("Tracing to " << filename << ", buffer=" << m_ring.size() << " records");
+    return true;
+}
+
+/**
+ * @brief Writes the buffered records and closes the file.
+ */
+void EventTracer::Close() {
+    if (!m_enabled) {
+        return;
+    }
+    Flush();
+    m_file.close();
+    m_enabled = false;
+    m_ring.clear();
+    m_ring.shrink_to_fit();
+    NS_LOG_INFO("Trace closed after " << m_recorded << " records");
+}
+
+/**
+ * @brief Writes the buffered records, oldest first, in at most two sequential writes.
+ */
+void EventTracer::Flush() {
+    if (!m_enabled || m_count == 0) {
+        return;
+    }
+    uint32_t size = m_ring.size();
+    uint32_t tail = (m_head + size - m_count) % size;
+    uint32_t first = std::min(m_count, size - tail);
+    m_file.write(reinterpret_cast<const char*>(&m_ring[tail]), first * sizeof(TraceRecord));
+    if (first < m_count) {
+        m_file.write(reinterpret_cast<const char*>(&m_ring[0]), (m_count - first) * sizeof(TraceRecord));
+    }
+    m_file.flush();
+    m_count = 0;
+}
+
+bool EventTracer::IsEnabled() const {
+    return m_enabled;
+}
+
+uint64_t EventTracer::GetRecordCount() const {
+    return m_recorded;
+}
+
+const char* EventTracer::GetEventName(uint8_t event) {
+    switch (event) {
+    case ENQUEUE:
+        return "enqueue";
+    case CLASSIFY:
+        return "classify";
+    case DROP:
+        return "drop";
+    case SCHEDULE:
+        return "schedule";
+    case DEFICIT:
+        return "deficit";
+    case DEQUEUE:
+        return "dequeue";
+    default:
+        return "unknown";
+    }
+}
+
+void EventTracer::Append(Event event, uint32_t queue, uint32_t size, uint32_t deficit) {
+    TraceRecord& record = m_ring[m_head];
+    record.time = Simulator::Now().GetNanoSeconds();
+    record.queue = queue;
+    record.size = size;
+    record.deficit = deficit;
+    record.event = event;
+    record.reserved[0] = record.reserved[1] = record.reserved[2] = 0;
+    m_head = (m_head + 1) % m_ring.size();
+    ++m_recorded;
+    if (++m_count == m_ring.size()) {
+        Flush();
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,96 @@
+#ifndef EVENT_TRACER_H
+#define EVENT_TRACER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * @brief One traced event, as written to the trace file.
+ *
+ * Records are fixed-size and written in host byte order, so the file can be read back
+ * with a single read per chunk (see model/tools/trace-decoder.cc).
+ */
+struct TraceRecord {
+    int64_t time;        // simulation time, in nanoseconds
+    uint32_t queue;      // traffic class index; the number of classes if none applies
+    uint32_t size;       // packet size, in bytes
+    uint32_t deficit;    // scheduler state after the event, e.g. the DRR deficit
+    uint8_t event;       // EventTracer::Event
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(TraceRecord) == 24, "TraceRecord must stay 24 bytes");
+
+/**
+ * @brief Header at the start of every trace file.
+ */
+struct TraceFileHeader {
+    char magic[8];        // "DSTRACE\0"
+    uint32_t version;
+    uint32_t recordSize;  // sizeof(TraceRecord) of the writer
+};
+
+/**
+ * @brief Binary tracer for queue internals, writing fixed-size records to a file.
+ *
+ * Records are appended to a preallocated in-memory ring and the ring is drained to the
+ * file in one sequential write whenever it fills up, and on Flush() and Close(). While
+ * the tracer is closed, Record() costs a single branch.
+ */
+class EventTracer {
+public:
+    enum Event : uint8_t {
+        ENQUEUE,
+        CLASSIFY,
+        DROP,
+        SCHEDULE,
+        DEFICIT,
+        DEQUEUE
+    };
+
+    static const uint32_t FORMAT_VERSION = 1;
+    static const uint32_t DEFAULT_BUFFER_RECORDS = 65536;
+
+    EventTracer();
+    ~EventTracer();
+
+    bool Open(const std::string& filename, uint32_t bufferRecords = DEFAULT_BUFFER_RECORDS);
+    void Close();
+    void Flush();
+    bool IsEnabled() const;
+    uint64_t GetRecordCount() const;
+    static const char* GetEventName(uint8_t event);
+
+    /**
+     * @brief Appends an event, timestamped with the current simulation time.
+     *
+     * @param event The event type.
+     * @param queue Index of the traffic class concerned.
+     * @param size Size of the packet concerned, in bytes.
+     * @param deficit Scheduler state after the event, or 0; saturated to 32 bits.
+     */
+    void Record(Event event, uint32_t queue, uint32_t size, uint64_t deficit = 0) {
+        if (m_enabled) {
+            Append(event, queue, size, static_cast<uint32_t>(std::min<uint64_t>(deficit, UINT32_MAX)));
+        }
+    }
+
+private:
+    void Append(Event event, uint32_t queue, uint32_t size, uint32_t deficit);
+
+    bool m_enabled;
+    std::ofstream m_file;
+    std::vector<TraceRecord> m_ring;
+    uint32_t m_head;   // next slot to write
+    uint32_t m_count;  // records held in the ring, not yet written
+    uint64_t m_recorded;
+};
+
+} // namespace ns3
+
+#endif /* EVENT_TRACER_H */
@@ -1,94 +1,138 @@
 #include "filter-element.h"
-#include "ns3/packet.h"
-#include "ns3/ppp-header.h"
-#include "ns3/ipv4-header.h"
-#include "ns3/udp-header.h"
-#include "ns3/tcp-header.h"
+#include "ns3/log.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cctype>
+#include <charconv>
 
 namespace ns3 {
 
+NS_LOG_COMPONENT_DEFINE("FilterElement");
+
+namespace {
+
+/**
+ * @brief Splits an IPv6 address into two host-order words, most significant first.
+ */
+void ToWords(Ipv6Address addr, uint64_t words[2]) {
+    uint8_t bytes[16];
+    addr.GetBytes(bytes);
+    words[0] = words[1] = 0;
+    for (int i = 0; i < 8; i++) {
+        words[0] = (words[0] << 8) | bytes[i];
+        words[1] = (words[1] << 8) | bytes[i + 8];
+    }
+}
+
+/**
+ * @brief Builds the two-word mask selecting the first prefixLength bits of an address.
+ */
+void PrefixMask(uint32_t prefixLength, uint64_t mask[2]) {
+    mask[0] = prefixLength == 0 ? 0 : ~0ULL << (64 - std::min(prefixLength, 64u));
+    mask[1] = prefixLength <= 64 ? 0 : ~0ULL << (128 - prefixLength);
+}
+
+} // namespace
+
+MatchSpec FilterElement::GetSpec() const {
+    return {MatchField::Opaque, 0, 0, 0};
+}
+
 SrcIPAddress::SrcIPAddress(Ipv4Address addr) : default_address(addr) {}
 
 /**
  * @brief Checks if the packet's source IP address matches the filter's address.
  *
- * Removes the PPP header, peeks at the IPv4 header, and compares the packet's source IP address
- * with the stored address. Logs the matching result.
+ * Compares the source IP address extracted into the flow key with the stored address.
+ * Logs the matching result.
  *
- * @param p Pointer to the packet to be evaluated.
+ * @param key Header fields extracted from the packet being evaluated.
  * @return True if the packet's source IP address matches, false otherwise.
  */
-bool SrcIPAddress::match(Ptr<Packet> p) const {
-    Ptr<Packet> p_copy = p->Copy();
-    PppHeader pppHeader;
-    p_copy->RemoveHeader(pppHeader);
-    Ipv4Header header;
-    p_copy->PeekHeader(header);
-    bool matches = (header.GetSource() == default_address);
-    std::cout << "SrcIPAddress::match: Source IP=" << header.GetSource() 
-              << ", expected=" << default_address << ", match=" << (matches ? "true" : "false") << std::endl;
+bool SrcIPAddress::match(const FlowKey& key) const {
+    bool matches = key.valid && !key.ipv6 && key.srcAddress == default_address.Get();
+    NS_LOG_LOGIC("SrcIPAddress: Source IP=" << Ipv4Address(key.srcAddress)
+                 << ", expected=" << default_address << ", match=" << (matches ? "true" : "false"));
     return matches;
 }
 
+MatchSpec SrcIPAddress::GetSpec() const {
+    return {MatchField::SrcAddress, default_address.Get(), 0xffffffff, 0};
+}
+
 SrcMask::SrcMask(Ipv4Address addr, Ipv4Mask mask) : default_address(addr), default_mask(mask) {}
 
 /**
  * @brief Checks if the packet's source IP address matches the filter's address and mask.
  *
- * Removes the PPP header, peeks at the IPv4 header, applies the mask to the packet's source IP
- * address, and compares it with the stored address. Logs the matching result.
+ * Applies the mask to the source IP address extracted into the flow key and compares it
+ * with the stored address. Logs the matching result.
  *
- * @param p Pointer to the packet to be evaluated.
+ * @param key Header fields extracted from the packet being evaluated.
  * @return True if the packet's source IP address matches, false otherwise.
  */
-bool SrcMask::match(Ptr<Packet> p) const {
-    Ptr<Packet> p_copy = p->Copy();
-    PppHeader pppHeader;
-    p_copy->RemoveHeader(pppHeader);
-    Ipv4Header header;
-    p_copy->PeekHeader(header);
-    bool matches = default_mask.IsMatch(header.GetSource(), default_address);
-    std::cout << "SrcMask::match: Source IP=" << header.GetSource() 
-              << ", expected=" << default_address << ", mask=" << default_mask 
-              << ", match=" << (matches ? "true" : "false") << std::endl;
+bool SrcMask::match(const FlowKey& key) const {
+    bool matches = key.valid && !key.ipv6 && default_mask.IsMatch(Ipv4Address(key.srcAddress), default_address);
+    NS_LOG_LOGIC("SrcMask: Source IP=" << Ipv4Address(key.srcAddress)
+                 << ", expected=" << default_address << ", mask=" << default_mask
+                 << ", match=" << (matches ? "true" : "false"));
     return matches;
 }
 
+MatchSpec SrcMask::GetSpec() const {
+    return {MatchField::SrcAddress, default_address.Get() & default_mask.Get(), default_mask.Get(), 0};
+}
+
 SrcPortNumber::SrcPortNumber(uint32_t port) : default_port(port) {}
 
 /**
  * @brief Checks if the packet's source port number matches the filter's port.
  *
- * Removes the PPP and IPv4 headers, checks the protocol (UDP or TCP), and compares the packet's
- * source port number with the stored port. Logs the matching result.
+ * Only UDP and TCP packets carry ports; any other protocol never matches. Logs the
+ * matching result.
  *
- * @param p Pointer to the packet to be evaluated.
+ * @param key Header fields extracted from the packet being evaluated.
  * @return True if the packet's source port number matches, false otherwise.
  */
-bool SrcPortNumber::match(Ptr<Packet> p) const {
-    Ptr<Packet> p_copy = p->Copy();
-    PppHeader pppHeader;
-    p_copy->RemoveHeader(pppHeader);
-    Ipv4Header header;
-    p_copy->RemoveHeader(header);
-    uint8_t protocol = header.GetProtocol();
-    if (protocol == 17) { // UDP
-        UdpHeader udpHeader;
-        p_copy->PeekHeader(udpHeader);
-        bool matches = (udpHeader.GetSourcePort() == default_port);
-        std::cout << "SrcPortNumber::match: Protocol=UDP, Source Port=" << udpHeader.GetSourcePort() 
-                  << ", expected=" << default_port << ", match=" << (matches ? "true" : "false") << std::endl;
-        return matches;
-    } else if (protocol == 6) { // TCP
-        TcpHeader tcpHeader;
-        p_copy->PeekHeader(tcpHeader);
-        bool matches = (tcpHeader.GetSourcePort() == default_port);
-        std::cout << "SrcPortNumber::match: Protocol=TCP, Source Port=" << tcpHeader.GetSourcePort() 
-                  << ", expected=" << default_port << ", match=" << (matches ? "true" : "false") << std::endl;
-        return matches;
+bool SrcPortNumber::match(const FlowKey& key) const {
+    if (!key.hasPorts) {
+        NS_LOG_LOGIC("SrcPortNumber: Unknown protocol=" << static_cast<uint32_t>(key.protocol) << ", no match");
+        return false;
     }
-    std::cout << "SrcPortNumber::match: Unknown protocol=" << static_cast<uint32_t>(protocol) << ", no match" << std::endl;
-    return false;
+    bool matches = (key.srcPort == default_port);
+    NS_LOG_LOGIC("SrcPortNumber: Protocol=" << static_cast<uint32_t>(key.protocol) << ", Source Port=" << key.srcPort
+                 << ", expected=" << default_port << ", match=" << (matches ? "true" : "false"));
+    return matches;
+}
+
+MatchSpec SrcPortNumber::GetSpec() const {
+    return {MatchField::SrcPort, default_port, 0xffff, default_port};
+}
+
+SrcPortRange::SrcPortRange(uint32_t low, uint32_t high) : low_port(low), high_port(high) {}
+
+/**
+ * @brief Checks if the packet's source port number lies within the filter's range.
+ *
+ * Only UDP and TCP packets carry ports; any other protocol never matches. Logs the
+ * matching result.
+ *
+ * @param key Header fields extracted from the packet being evaluated.
+ * @return True if low <= source port <= high, false otherwise.
+ */
+bool SrcPortRange::match(const FlowKey& key) const {
+    if (!key.hasPorts) {
+        NS_LOG_LOGIC("SrcPortRange: Unknown protocol=" << static_cast<uint32_t>(key.protocol) << ", no match");
+        return false;
+    }
+    bool matches = key.srcPort >= low_port && key.srcPort <= high_port;
+    NS_LOG_LOGIC("SrcPortRange: Protocol=" << static_cast<uint32_t>(key.protocol) << ", Source Port=" << key.srcPort
+                 << ", expected=" << low_port << "-" << high_port << ", match=" << (matches ? "true" : "false"));
+    return matches;
+}
+
+MatchSpec SrcPortRange::GetSpec() const {
+    return {MatchField::SrcPort, low_port, 0xffff, high_port};
 }
 
 DstIPAddress::DstIPAddress(Ipv4Address addr) : default_address(addr) {}
@@ -96,83 +140,96 @@ DstIPAddress::DstIPAddress(Ipv4Address addr) : default_address(addr) {}
 /**
  * @brief Checks if the packet's destination IP address matches the filter's address.
  *
- * Removes the PPP header, peeks at the IPv4 header, and compares the packet's destination IP
- * address with the stored address. Logs the matching result.
+ * Compares the destination IP address extracted into the flow key with the stored
+ * address. Logs the matching result.
  *
- * @param p Pointer to the packet to be evaluated.
+ * @param key Header fields extracted from the packet being evaluated.
  * @return True if the packet's destination IP address matches, false otherwise.
  */
-bool DstIPAddress::match(Ptr<Packet> p) const {
-    Ptr<Packet> p_copy = p->Copy();
-    PppHeader pppHeader;
-    p_copy->RemoveHeader(pppHeader);
-    Ipv4Header header;
-    p_copy->PeekHeader(header);
-    bool matches = (header.GetDestination() == default_address);
-    std::cout << "DstIPAddress::match: Destination IP=" << header.GetDestination() 
-              << ", expected=" << default_address << ", match=" << (matches ? "true" : "false") << std::endl;
+bool DstIPAddress::match(const FlowKey& key) const {
+    bool matches = key.valid && !key.ipv6 && key.dstAddress == default_address.Get();
+    NS_LOG_LOGIC("DstIPAddress: Destination IP=" << Ipv4Address(key.dstAddress)
+                 << ", expected=" << default_address << ", match=" << (matches ? "true" : "false"));
     return matches;
 }
 
+MatchSpec DstIPAddress::GetSpec() const {
+    return {MatchField::DstAddress, default_address.Get(), 0xffffffff, 0};
+}
+
 DstMask::DstMask(Ipv4Address addr, Ipv4Mask mask) : default_address(addr), default_mask(mask) {}
 
 /**
  * @brief Checks if the packet's destination IP address matches the filter's address and mask.
  *
- * Removes the PPP header, peeks at the IPv4 header, applies the mask to the packet's destination
- * IP address, and compares it with the stored address. Logs the matching result.
+ * Applies the mask to the destination IP address extracted into the flow key and compares
+ * it with the stored address. Logs the matching result.
  *
- * @param p Pointer to the packet to be evaluated.
+ * @param key Header fields extracted from the packet being evaluated.
  * @return True if the packet's destination IP address matches, false otherwise.
  */
-bool DstMask::match(Ptr<Packet> p) const {
-    Ptr<Packet> p_copy = p->Copy();
-    PppHeader pppHeader;
-    p_copy->RemoveHeader(pppHeader);
-    Ipv4Header header;
-    p_copy->PeekHeader(header);
-    bool matches = default_mask.IsMatch(header.GetDestination(), default_address);
-    std::cout << "DstMask::match: Destination IP=" << header.GetDestination() 
-              << ", expected=" << default_address << ", mask=" << default_mask 
-              << ", match=" << (matches ? "true" : "false") << std::endl;
+bool DstMask::match(const FlowKey& key) const {
+    bool matches = key.valid && !key.ipv6 && default_mask.IsMatch(Ipv4Address(key.dstAddress), default_address);
+    NS_LOG_LOGIC("DstMask: Destination IP=" << Ipv4Address(key.dstAddress)
+                 << ", expected=" << default_address << ", mask=" << default_mask
+                 << ", match=" << (matches ? "true" : "false"));
     return matches;
 }
 
+MatchSpec DstMask::GetSpec() const {
+    return {MatchField::DstAddress, default_address.Get() & default_mask.Get(), default_mask.Get(), 0};
+}
+
 DstPortNumber::DstPortNumber(uint32_t port) : default_port(port) {}
 
 /**
  * @brief Checks if the packet's destination port number matches the filter's port.
  *
- * Removes the PPP and IPv4 headers, checks the protocol (UDP or TCP), and compares the packet's
- * destination port number with the stored port. Logs the matching result.
+ * Only UDP and TCP packets carry ports; any other protocol never matches. Logs the
+ * matching result.
  *
- * @param p Pointer to the packet to be evaluated.
+ * @param key Header fields extracted from the packet being evaluated.
  * @return True if the packet's destination port number matches, false otherwise.
  */
-bool DstPortNumber::match(Ptr<Packet> p) const {
-    Ptr<Packet> p_copy = p->Copy();
-    PppHeader pppHeader;
-    p_copy->RemoveHeader(pppHeader);
-    Ipv4Header header;
-    p_copy->RemoveHeader(header);
-    uint8_t protocol = header.GetProtocol();
-    if (protocol == 17) { // UDP
-        UdpHeader udpHeader;
-        p_copy->PeekHeader(udpHeader);
-        bool matches = (udpHeader.GetDestinationPort() == default_port);
-        std::cout << "DstPortNumber::match: Protocol=UDP, Destination Port=" << udpHeader.GetDestinationPort() 
-                  << ", expected=" << default_port << ", match=" << (matches ? "true" : "false") << std::endl;
-        return matches;
-    } else if (protocol == 6) { // TCP
-        TcpHeader tcpHeader;
-        p_copy->PeekHeader(tcpHeader);
-        bool matches = (tcpHeader.GetDestinationPort() == default_port);
-        std::cout << "DstPortNumber::match: Protocol=TCP, Destination Port=" << tcpHeader.GetDestinationPort() 
-                  << ", expected=" << default_port << ", match=" << (matches ? "true" : "false") << std::endl;
-        return matches;
+bool DstPortNumber::match(const FlowKey& key) const {
+    if (!key.hasPorts) {
+        NS_LOG_LOGIC("DstPortNumber: Unknown protocol=" << static_cast<uint32_t>(key.protocol) << ", no match");
+        return false;
     }
-    std::cout << "DstPortNumber::match: Unknown protocol=" << static_cast<uint32_t>(protocol) << ", no match" << std::endl;
-    return false;
+    bool matches = (key.dstPort == default_port);
+    NS_LOG_LOGIC("DstPortNumber: Protocol=" << static_cast<uint32_t>(key.protocol) << ", Destination Port=" << key.dstPort
+                 << ", expected=" << default_port << ", match=" << (matches ? "true" : "false"));
+    return matches;
+}
+
+MatchSpec DstPortNumber::GetSpec() const {
+    return {MatchField::DstPort, default_port, 0xffff, default_port};
+}
+
+DstPortRange::DstPortRange(uint32_t low, uint32_t high) : low_port(low), high_port(high) {}
+
+/**
+ * @brief Checks if the packet's destination port number lies within the filter's range.
+ *
+ * Only UDP and TCP packets carry ports; any other protocol never matches. Logs the
+ * matching result.
+ *
+ * @param key Header fields extracted from the packet being evaluated.
+ * @return True if low <= destination port <= high, false otherwise.
+ */
+bool DstPortRange::match(const FlowKey& key) const {
+    if (!key.hasPorts) {
+        NS_LOG_LOGIC("DstPortRange: Unknown protocol=" << static_cast<uint32_t>(key.protocol) << ", no match");
+        return false;
+    }
+    bool matches = key.dstPort >= low_port && key.dstPort <= high_port;
+    NS_LOG_LOGIC("DstPortRange: Protocol=" << static_cast<uint32_t>(key.protocol) << ", Destination Port=" << key.dstPort
+                 << ", expected=" << low_port << "-" << high_port << ", match=" << (matches ? "true" : "false"));
+    return matches;
+}
+
+MatchSpec DstPortRange::GetSpec() const {
+    return {MatchField::DstPort, low_port, 0xffff, high_port};
 }
 
 ProtocolNumber::ProtocolNumber(uint32_t protocol) : default_protocol(protocol) {}
@@ -180,22 +237,313 @@ ProtocolNumber::ProtocolNumber(uint32_t protocol) : default_protocol(protocol) {
 /**
  * @brief Checks if the packet's protocol number matches the filter's protocol.
  *
- * Removes the PPP header, peeks at the IPv4 header, and compares the packet's protocol number
- * with the stored protocol. Logs the matching result.
+ * Compares the IPv4 protocol number extracted into the flow key with the stored
+ * protocol; IPv6 packets are matched by NextHeader instead. Logs the matching result.
  *
- * @param p Pointer to the packet to be evaluated.
+ * @param key Header fields extracted from the packet being evaluated.
  * @return True if the packet's protocol number matches, false otherwise.
  */
-bool ProtocolNumber::match(Ptr<Packet> p) const {
-    Ptr<Packet> p_copy = p->Copy();
-    PppHeader pppHeader;
-    p_copy->RemoveHeader(pppHeader);
-    Ipv4Header header;
-    p_copy->PeekHeader(header);
-    bool matches = (header.GetProtocol() == default_protocol);
-    std::cout << "ProtocolNumber::match: Protocol=" << static_cast<uint32_t>(header.GetProtocol()) 
-              << ", expected=" << default_protocol << ", match=" << (matches ? "true" : "false") << std::endl;
+bool ProtocolNumber::match(const FlowKey& key) const {
+    bool matches = key.valid && !key.ipv6 && key.protocol == default_protocol;
+    NS_LOG_LOGIC("ProtocolNumber: Protocol=" << static_cast<uint32_t>(key.protocol)
+                 << ", expected=" << default_protocol << ", match=" << (matches ? "true" : "false"));
+    return matches;
+}
+
+MatchSpec ProtocolNumber::GetSpec() const {
+    return {MatchField::Protocol, default_protocol, 0xff, 0};
+}
+
+SrcIpv6Address::SrcIpv6Address(Ipv6Address addr) : default_address(addr) {
+    ToWords(addr, address_words);
+}
+
+/**
+ * @brief Checks if the packet's IPv6 source address matches the filter's address.
+ *
+ * IPv4 packets never match. Logs the matching result.
+ *
+ * @param key Header fields extracted from the packet being evaluated.
+ * @return True if the packet's IPv6 source address matches, false otherwise.
+ */
+bool SrcIpv6Address::match(const FlowKey& key) const {
+    bool matches = key.valid && key.ipv6 && key.srcAddress6[0] == address_words[0]
+                && key.srcAddress6[1] == address_words[1];
+    NS_LOG_LOGIC("SrcIpv6Address: expected=" << default_address
+                 << ", match=" << (matches ? "true" : "false"));
     return matches;
 }
 
+MatchSpec SrcIpv6Address::GetSpec() const {
+    return {MatchField::SrcAddress6, 0, 128, 0, {address_words[0], address_words[1]}};
+}
+
+SrcIpv6Prefix::SrcIpv6Prefix(Ipv6Address addr, Ipv6Prefix prefix)
+    : default_address(addr), prefix_length(prefix.GetPrefixLength()) {
+    ToWords(addr, address_words);
+    PrefixMask(prefix_length, mask_words);
+    address_words[0] &= mask_words[0];
+    address_words[1] &= mask_words[1];
+}
+
+/**
+ * @brief Checks if the packet's IPv6 source address lies within the filter's prefix.
+ *
+ * IPv4 packets never match. Logs the matching result.
+ *
+ * @param key Header fields extracted from the packet being evaluated.
+ * @return True if the first prefix-length bits of the source address match, false otherwise.
+ */
+bool SrcIpv6Prefix::match(const FlowKey& key) const {
+    bool matches = key.valid && key.ipv6 && (key.srcAddress6[0] & mask_words[0]) == address_words[0]
+                && (key.srcAddress6[1] & mask_words[1]) == address_words[1];
+    NS_LOG_LOGIC("SrcIpv6Prefix: expected=" << default_address << "/" << prefix_length
+                 << ", match=" << (matches ? "true" : "false"));
+    return matches;
+}
+
+MatchSpec SrcIpv6Prefix::GetSpec() const {
+    return {MatchField::SrcAddress6, 0, prefix_length, 0, {address_words[0], address_words[1]}};
+}
+
+DstIpv6Address::DstIpv6Address(Ipv6Address addr) : default_address(addr) {
+    ToWords(addr, address_words);
+}
+
+/**
+ * @brief Checks if the packet's IPv6 destination address matches the filter's address.
+ *
+ * IPv4 packets never match. Logs the matching result.
+ *
+ * @param key Header fields extracted from the packet being evaluated.
+ * @return True if the packet's IPv6 destination address matches, false otherwise.
+ */
+bool DstIpv6Address::match(const FlowKey& key) const {
+    bool matches = key.valid && key.ipv6 && key.dstAddress6[0] == address_words[0]
+                && key.dstAddress6[1] == address_words[1];
+    NS_LOG_LOGIC("DstIpv6Address: expected=" << default_address
+                 << ", match=" << (matches ? "true" : "false"));
+    return matches;
+}
+
+MatchSpec DstIpv6Address::GetSpec() const {
+    return {MatchField::DstAddress6, 0, 128, 0, {address_words[0], address_words[1]}};
+}
+
+DstIpv6Prefix::DstIpv6Prefix(Ipv6Address addr, Ipv6Prefix prefix)
+    : default_address(addr), prefix_length(prefix.GetPrefixLength()) {
+    ToWords(addr, address_words);
+    PrefixMask(prefix_length, mask_words);
+    address_words[0] &= mask_words[0];
+    address_words[1] &= mask_words[1];
+}
+
+/**
+ * @brief Checks if the packet's IPv6 destination address lies within the filter's prefix.
+ *
+ * IPv4 packets never match. Logs the matching result.
+ *
+ * @param key Header fields extracted from the packet being evaluated.
+ * @return True if the first prefix-length bits of the destination address match, false otherwise.
+ */
+bool DstIpv6Prefix::match(const FlowKey& key) const {
+    bool matches = key.valid && key.ipv6 && (key.dstAddress6[0] & mask_words[0]) == address_words[0]
+                && (key.dstAddress6[1] & mask_words[1]) == address_words[1];
+    NS_LOG_LOGIC("DstIpv6Prefix: expected=" << default_address << "/" << prefix_length
+                 << ", match=" << (matches ? "true" : "false"));
+    return matches;
+}
+
+MatchSpec DstIpv6Prefix::GetSpec() const {
+    return {MatchField::DstAddress6, 0, prefix_length, 0, {address_words[0], address_words[1]}};
+}
+
+NextHeader::NextHeader(uint32_t nextHeader) : default_next_header(nextHeader) {}
+
+/**
+ * @brief Checks if the packet's IPv6 upper-layer protocol matches the filter's.
+ *
+ * Compares the header that follows the IPv6 extension-header chain, as extracted into
+ * the flow key, with the stored value. IPv4 packets never match. Logs the matching result.
+ *
+ * @param key Header fields extracted from the packet being evaluated.
+ * @return True if the packet's upper-layer protocol matches, false otherwise.
+ */
+bool NextHeader::match(const FlowKey& key) const {
+    bool matches = key.valid && key.ipv6 && key.protocol == default_next_header;
+    NS_LOG_LOGIC("NextHeader: Next Header=" << static_cast<uint32_t>(key.protocol)
+                 << ", expected=" << default_next_header << ", match=" << (matches ? "true" : "false"));
+    return matches;
+}
+
+MatchSpec NextHeader::GetSpec() const {
+    return {MatchField::NextHeader, default_next_header, 0xff, 0};
+}
+
+Dscp::Dscp(uint32_t dscp) : default_dscp(dscp) {}
+
+/**
+ * @brief Checks if the packet's DSCP matches the filter's code point.
+ *
+ * Compares the six DSCP bits of the IPv4 ToS byte or IPv6 Traffic Class, as extracted
+ * into the flow key, with the stored code point; the ECN bits are ignored. Logs the
+ * matching result.
+ *
+ * @param key Header fields extracted from the packet being evaluated.
+ * @return True if the packet's DSCP matches, false otherwise.
+ */
+bool Dscp::match(const FlowKey& key) const {
+    bool matches = key.valid && key.dscp == default_dscp;
+    NS_LOG_LOGIC("Dscp: DSCP=" << static_cast<uint32_t>(key.dscp)
+                 << ", expected=" << default_dscp << ", match=" << (matches ? "true" : "false"));
+    return matches;
+}
+
+MatchSpec Dscp::GetSpec() const {
+    return {MatchField::Dscp, default_dscp, 0x3f, 0};
+}
+
+namespace {
+
+/**
+ * @brief Parses a whole word as an unsigned number no greater than max.
+ */
+bool ParseNumber(std::string_view word, uint32_t max, uint32_t& value) {
+    auto [end, ec] = std::from_chars(word.data(), word.data() + word.size(), value);
+    return ec == std::errc() && end == word.data() + word.size() && !word.empty() && value <= max;
+}
+
+/**
+ * @brief Parses a DSCP given as a number (0-63) or a standard name (EF, AF11-AF43, CS0-CS7).
+ */
+bool ParseDscp(std::string_view value, uint32_t& dscp) {
+    std::string name;
+    for (char c : value) {
+        name += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    if (name == "EF") {
+        dscp = 46;
+        return true;
+    }
+    if (name.size() == 4 && name.compare(0, 2, "AF") == 0 && name[2] >= '1' && name[2] <= '4'
+        && name[3] >= '1' && name[3] <= '3') {
+        dscp = (name[2] - '0') * 8 + (name[3] - '0') * 2;
+        return true;
+    }
+    if (name.size() == 3 && name.compare(0, 2, "CS") == 0 && name[2] >= '0' && name[2] <= '7') {
+        dscp = (name[2] - '0') * 8;
+        return true;
+    }
+    return ParseNumber(value, 63, dscp);
+}
+
+/**
+ * @brief Parses an IPv4 or IPv6 literal, with an optional "/length" prefix.
+ *
+ * @param value The word to parse.
+ * @param bytes Receives the address in network order; an IPv4 address fills the first 4.
+ * @param ipv6 Receives whether the address is an IPv6 one.
+ * @param prefixLength Receives the prefix length, or -1 if there is none.
+ * @return False if the word is not a valid address or prefix.
+ */
+bool ParseAddress(std::string_view value, uint8_t bytes[16], bool& ipv6, int32_t& prefixLength) {
+    size_t slash = value.find('/');
+    std::string_view address = value.substr(0, slash);
+    char text[INET6_ADDRSTRLEN];
+    if (address.size() >= sizeof(text)) {
+        return false;
+    }
+    address.copy(text, address.size());
+    text[address.size()] = '\0';
+    ipv6 = address.find(':') != std::string_view::npos;
+    if (inet_pton(ipv6 ? AF_INET6 : AF_INET, text, bytes) != 1) {
+        return false;
+    }
+    prefixLength = -1;
+    uint32_t length;
+    if (slash != std::string_view::npos) {
+        if (!ParseNumber(value.substr(slash + 1), ipv6 ? 128 : 32, length)) {
+            return false;
+        }
+        prefixLength = static_cast<int32_t>(length);
+    }
+    return true;
+}
+
+/**
+ * @brief Parses a port or an inclusive "low-high" port range.
+ */
+bool ParsePorts(std::string_view value, uint32_t& low, uint32_t& high) {
+    size_t dash = value.find('-');
+    if (dash == std::string_view::npos) {
+        if (!ParseNumber(value, 65535, low)) {
+            return false;
+        }
+        high = low;
+        return true;
+    }
+    return ParseNumber(value.substr(0, dash), 65535, low) && ParseNumber(value.substr(dash + 1), 65535, high)
+           && low <= high;
+}
+
+} // namespace
+
+/**
+ * @brief Creates the filter element named by a config file token.
+ *
+ * Shared by the config parsers of all schedulers. Address values may be IPv4 or IPv6
+ * literals, optionally followed by "/length" to give a prefix. Port values may be a
+ * single port or an inclusive "low-high" range; DSCP values a number or a name such as
+ * EF or AF21. Values are validated and parsed without exceptions or allocation, so rule
+ * files with many filters load quickly.
+ *
+ * @param type The filter type token, e.g. "src_ip" or "dst_port".
+ * @param value The value token.
+ * @return The new element, or nullptr if the type is unknown or the value malformed.
+ */
+FilterElement* CreateFilterElement(std::string_view type, std::string_view value) {
+    if (type == "src_ip" || type == "dst_ip") {
+        bool src = (type == "src_ip");
+        uint8_t bytes[16];
+        bool ipv6;
+        int32_t prefixLength;
+        if (!ParseAddress(value, bytes, ipv6, prefixLength)) {
+            return nullptr;
+        }
+        if (ipv6) {
+            Ipv6Address addr(bytes);
+            if (prefixLength < 0) {
+                return src ? static_cast<FilterElement*>(new SrcIpv6Address(addr)) : new DstIpv6Address(addr);
+            }
+            Ipv6Prefix prefix(static_cast<uint8_t>(prefixLength));
+            return src ? static_cast<FilterElement*>(new SrcIpv6Prefix(addr, prefix)) : new DstIpv6Prefix(addr, prefix);
+        }
+        Ipv4Address addr((uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | bytes[3]);
+        if (prefixLength < 0) {
+            return src ? static_cast<FilterElement*>(new SrcIPAddress(addr)) : new DstIPAddress(addr);
+        }
+        Ipv4Mask mask(prefixLength == 0 ? 0 : ~uint32_t(0) << (32 - prefixLength));
+        return src ? static_cast<FilterElement*>(new SrcMask(addr, mask)) : new DstMask(addr, mask);
+    }
+    uint32_t number;
+    if (type == "src_port" || type == "dst_port") {
+        bool src = (type == "src_port");
+        uint32_t high;
+        if (!ParsePorts(value, number, high)) {
+            return nullptr;
+        }
+        if (value.find('-') == std::string_view::npos) {
+            return src ? static_cast<FilterElement*>(new SrcPortNumber(number)) : new DstPortNumber(number);
+        }
+        return src ? static_cast<FilterElement*>(new SrcPortRange(number, high)) : new DstPortRange(number, high);
+    } else if (type == "protocol") {
+        return ParseNumber(value, 255, number) ? new ProtocolNumber(number) : nullptr;
+    } else if (type == "next_header") {
+        return ParseNumber(value, 255, number) ? new NextHeader(number) : nullptr;
+    } else if (type == "dscp") {
+        return ParseDscp(value, number) ? new Dscp(number) : nullptr;
+    }
+    return nullptr;
+}
+
 } // namespace ns3
@@ -1,26 +1,62 @@
 #ifndef FILTER_ELEMENT_H
 #define FILTER_ELEMENT_H
 
-#include "ns3/packet.h"
 #include "ns3/object.h"
-#include "ns3/ppp-header.h"
-#include "ns3/ipv4-header.h"
-#include "ns3/udp-header.h"
-#include "ns3/tcp-header.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv6-address.h"
+#include "flow-key.h"
+#include <string>
+#include <string_view>
 
 namespace ns3 {
 
+/**
+ * @brief Header field tested by a FilterElement.
+ *
+ * Opaque elements cannot be indexed and are always evaluated through match().
+ */
+enum class MatchField : uint8_t {
+    SrcAddress,
+    DstAddress,
+    SrcAddress6,
+    DstAddress6,
+    SrcPort,
+    DstPort,
+    Protocol,
+    NextHeader,
+    Dscp,
+    Opaque
+};
+
+/**
+ * @brief Description of the test a FilterElement performs, used by ClassifierIndex.
+ *
+ * Address, protocol, next-header and DSCP elements match when (field & mask) == value;
+ * value is already masked. Port elements match when value <= port <= high. IPv6 address
+ * elements match when the first mask bits of the address equal those of value6, which
+ * is already masked.
+ */
+struct MatchSpec {
+    MatchField field;
+    uint32_t value;
+    uint32_t mask;
+    uint32_t high;
+    uint64_t value6[2] = {0, 0};
+};
+
 class FilterElement : public Object {
 public:
     static TypeId GetTypeId(void);
-    virtual bool match(Ptr<Packet> p) const = 0;
+    virtual bool match(const FlowKey& key) const = 0;
+    virtual MatchSpec GetSpec() const;
 };
 
 class SrcIPAddress : public FilterElement {
 public:
     static TypeId GetTypeId(void);
     SrcIPAddress(Ipv4Address addr);
-    bool match(Ptr<Packet> p) const override;
+    bool match(const FlowKey& key) const override;
+    MatchSpec GetSpec() const override;
 
 private:
     Ipv4Address default_address;
@@ -30,7 +66,8 @@ class SrcMask : public FilterElement {
 public:
     static TypeId GetTypeId(void);
     SrcMask(Ipv4Address addr, Ipv4Mask mask);
-    bool match(Ptr<Packet> p) const override;
+    bool match(const FlowKey& key) const override;
+    MatchSpec GetSpec() const override;
 
 private:
     Ipv4Address default_address;
@@ -41,17 +78,31 @@ class SrcPortNumber : public FilterElement {
 public:
     static TypeId GetTypeId(void);
     SrcPortNumber(uint32_t port);
-    bool match(Ptr<Packet> p) const override;
+    bool match(const FlowKey& key) const override;
+    MatchSpec GetSpec() const override;
 
 private:
     uint32_t default_port;
 };
 
+class SrcPortRange : public FilterElement {
+public:
+    static TypeId GetTypeId(void);
+    SrcPortRange(uint32_t low, uint32_t high);
+    bool match(const FlowKey& key) const override;
+    MatchSpec GetSpec() const override;
+
+private:
+    uint32_t low_port;
+    uint32_t high_port;
+};
+
 class DstIPAddress : public FilterElement {
 public:
     static TypeId GetTypeId(void);
     DstIPAddress(Ipv4Address addr);
-    bool match(Ptr<Packet> p) const override;
+    bool match(const FlowKey& key) const override;
+    MatchSpec GetSpec() const override;
 
 private:
     Ipv4Address default_address;
@@ -61,7 +112,8 @@ class DstMask : public FilterElement {
 public:
     static TypeId GetTypeId(void);
     DstMask(Ipv4Address addr, Ipv4Mask mask);
-    bool match(Ptr<Packet> p) const override;
+    bool match(const FlowKey& key) const override;
+    MatchSpec GetSpec() const override;
 
 private:
     Ipv4Address default_address;
@@ -72,22 +124,112 @@ class DstPortNumber : public FilterElement {
 public:
     static TypeId GetTypeId(void);
     DstPortNumber(uint32_t port);
-    bool match(Ptr<Packet> p) const override;
+    bool match(const FlowKey& key) const override;
+    MatchSpec GetSpec() const override;
 
 private:
     uint32_t default_port;
 };
 
+class DstPortRange : public FilterElement {
+public:
+    static TypeId GetTypeId(void);
+    DstPortRange(uint32_t low, uint32_t high);
+    bool match(const FlowKey& key) const override;
+    MatchSpec GetSpec() const override;
+
+private:
+    uint32_t low_port;
+    uint32_t high_port;
+};
+
 class ProtocolNumber : public FilterElement {
 public:
     static TypeId GetTypeId(void);
     ProtocolNumber(uint32_t protocol);
-    bool match(Ptr<Packet> p) const override;
+    bool match(const FlowKey& key) const override;
+    MatchSpec GetSpec() const override;
 
 private:
     uint32_t default_protocol;
 };
 
+class SrcIpv6Address : public FilterElement {
+public:
+    static TypeId GetTypeId(void);
+    SrcIpv6Address(Ipv6Address addr);
+    bool match(const FlowKey& key) const override;
+    MatchSpec GetSpec() const override;
+
+private:
+    Ipv6Address default_address;
+    uint64_t address_words[2];
+};
+
+class SrcIpv6Prefix : public FilterElement {
+public:
+    static TypeId GetTypeId(void);
+    SrcIpv6Prefix(Ipv6Address addr, Ipv6Prefix prefix);
+    bool match(const FlowKey& key) const override;
+    MatchSpec GetSpec() const override;
+
+private:
+    Ipv6Address default_address;
+    uint32_t prefix_length;
+    uint64_t address_words[2];
+    uint64_t mask_words[2];
+};
+
+class DstIpv6Address : public FilterElement {
+public:
+    static TypeId GetTypeId(void);
+    DstIpv6Address(Ipv6Address addr);
+    bool match(const FlowKey& key) const override;
+    MatchSpec GetSpec() const override;
+
+private:
+    Ipv6Address default_address;
+    uint64_t address_words[2];
+};
+
+class DstIpv6Prefix : public FilterElement {
+public:
+    static TypeId GetTypeId(void);
+    DstIpv6Prefix(Ipv6Address addr, Ipv6Prefix prefix);
+    bool match(const FlowKey& key) const override;
+    MatchSpec GetSpec() const override;
+
+private:
+    Ipv6Address default_address;
+    uint32_t prefix_length;
+    uint64_t address_words[2];
+    uint64_t mask_words[2];
+};
+
+class NextHeader : public FilterElement {
+public:
+    static TypeId GetTypeId(void);
+    NextHeader(uint32_t nextHeader);
+    bool match(const FlowKey& key) const override;
+    MatchSpec GetSpec() const override;
+
+private:
+    uint32_t default_next_header;
+};
+
+class Dscp : public FilterElement {
+public:
+    static TypeId GetTypeId(void);
+    Dscp(uint32_t dscp);
+    bool match(const FlowKey& key) const override;
+    MatchSpec GetSpec() const override;
+
+private:
+    uint32_t default_dscp;
+};
+
+FilterElement* CreateFilterElement(std::string_view type, std::string_view value);
+
 } // namespace ns3
 
 #endif /* FILTER_ELEMENT_H */
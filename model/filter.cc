@@ -1,9 +1,12 @@
 #include "filter.h"
 #include "filter-element.h"
+#include "ns3/log.h"
 #include "ns3/packet.h"
 
 namespace ns3 {
 
+NS_LOG_COMPONENT_DEFINE("Filter");
+
 Filter::Filter() {}
 
 Filter::~Filter() {
@@ -16,20 +19,21 @@ Filter::~Filter() {
 /**
  * @brief Checks if a packet matches all filter elements.
  *
- * Iterates through the list of filter elements and evaluates the packet against each one.
- * If any element rejects the packet, the method returns false. Logs the outcome of the match.
+ * Iterates through the list of filter elements and evaluates the packet's flow key against
+ * each one. If any element rejects the packet, the method returns false. Logs the outcome
+ * of the match.
  *
- * @param p Pointer to the packet to be evaluated.
+ * @param key Header fields extracted from the packet being evaluated.
  * @return True if the packet matches all filter elements, false otherwise.
  */
-bool Filter::match(Ptr<Packet> p) {
+bool Filter::match(const FlowKey& key) {
     for (size_t i = 0; i < elements.size(); ++i) {
-        if (!elements[i]->match(p)) {
-            std::cout << "Filter::match: Packet rejected by element " << i << std::endl;
+        if (!elements[i]->match(key)) {
+            NS_LOG_LOGIC("Packet rejected by element " << i);
             return false;
         }
     }
-    std::cout << "Filter::match: Packet accepted" << std::endl;
+    NS_LOG_LOGIC("Packet accepted");
     return true;
 }
 
@@ -42,7 +46,7 @@ bool Filter::match(Ptr<Packet> p) {
  */
 void Filter::AddElement(FilterElement* e) {
     elements.push_back(e);
-    std::cout << "Filter::AddElement: Added element, total elements=" << elements.size() << std::endl;
+    NS_LOG_INFO("Added element, total elements=" << elements.size());
 }
 
 } // namespace ns3
@@ -13,7 +13,7 @@ public:
     Filter();
     virtual ~Filter();
 
-    bool match(Ptr<Packet> p);
+    bool match(const FlowKey& key);
     void AddElement(FilterElement* elem);
 
     std::vector<FilterElement*> elements;
@@ -0,0 +1,151 @@
+#include "flow-cache.h"
+
+namespace ns3 {
+
+FlowCache::FlowCache()
+    : m_capacity(0), m_setMask(0), m_policy(CLOCK), m_generation(1), m_tick(0),
+      m_hits(0), m_misses(0), m_evictions(0) {
+}
+
+/**
+ * @brief Resizes the cache, dropping all cached entries.
+ *
+ * The capacity is rounded up to a power-of-two number of sets. A capacity of zero
+ * disables the cache.
+ *
+ * @param entries The requested number of entries.
+ */
+void FlowCache::SetCapacity(uint32_t entries) {
+    uint32_t sets = 0;
+    if (entries > 0) {
+        sets = 1;
+        while (sets * WAYS < entries) {
+            sets <<= 1;
+        }
+    }
+    m_capacity = sets * WAYS;
+    m_setMask = sets > 0 ? sets - 1 : 0;
+    m_entries.assign(m_capacity, Entry());
+    m_hands.assign(sets, 0);
+    m_generation = 1;
+}
+
+uint32_t FlowCache::GetCapacity() const {
+    return m_capacity;
+}
+
+void FlowCache::SetPolicy(Policy policy) {
+    m_policy = policy;
+}
+
+FlowCache::Policy FlowCache::GetPolicy() const {
+    return m_policy;
+}
+
+/**
+ * @brief Looks up the queue index cached for the packet's flow.
+ *
+ * @param key Header fields extracted from the packet.
+ * @param queueIndex Set to the cached queue index on a hit.
+ * @return True on a hit, false on a miss or if the cache is disabled.
+ */
+bool FlowCache::Lookup(const FlowKey& key, uint32_t& queueIndex) {
+    if (m_capacity == 0) {
+        return false;
+    }
+    Entry* set = &m_entries[(key.Hash() & m_setMask) * WAYS];
+    for (uint32_t way = 0; way < WAYS; ++way) {
+        Entry& entry = set[way];
+        if (entry.generation == m_generation && entry.key.SameFlow(key)) {
+            entry.lastUse = ++m_tick;
+            entry.referenced = true;
+            queueIndex = entry.queueIndex;
+            ++m_hits;
+            return true;
+        }
+    }
+    ++m_misses;
+    return false;
+}
+
+/**
+ * @brief Caches the classification result of a flow after a miss.
+ *
+ * Uses a free way of the flow's set if there is one; otherwise evicts the least
+ * recently used entry (LRU) or the first entry the clock hand finds unreferenced (CLOCK).
+ *
+ * @param key Header fields extracted from the packet.
+ * @param queueIndex The queue index the packet was classified to.
+ */
+void FlowCache::Insert(const FlowKey& key, uint32_t queueIndex) {
+    if (m_capacity == 0) {
+        return;
+    }
+    uint32_t setIndex = key.Hash() & m_setMask;
+    Entry* set = &m_entries[setIndex * WAYS];
+
+    uint32_t victim = WAYS;
+    for (uint32_t way = 0; way < WAYS; ++way) {
+        if (set[way].generation != m_generation) {
+            victim = way;
+            break;
+        }
+    }
+    if (victim == WAYS) {
+        ++m_evictions;
+        if (m_policy == LRU) {
+            victim = 0;
+            for (uint32_t way = 1; way < WAYS; ++way) {
+                // unsigned differences stay correct across tick wrap-around
+                if (m_tick - set[way].lastUse > m_tick - set[victim].lastUse) {
+                    victim = way;
+                }
+            }
+        } else {
+            uint8_t& hand = m_hands[setIndex];
+            while (set[hand].referenced) {
+                set[hand].referenced = false;
+                hand = (hand + 1) % WAYS;
+            }
+            victim = hand;
+            hand = (hand + 1) % WAYS;
+        }
+    }
+
+    Entry& entry = set[victim];
+    entry.key = key;
+    entry.queueIndex = queueIndex;
+    entry.generation = m_generation;
+    entry.lastUse = ++m_tick;
+    entry.referenced = false;
+}
+
+/**
+ * @brief Drops every cached entry, to be called whenever the rule set changes.
+ */
+void FlowCache::Invalidate() {
+    if (++m_generation == 0) {
+        m_entries.assign(m_capacity, Entry());
+        m_generation = 1;
+    }
+}
+
+uint64_t FlowCache::GetHits() const {
+    return m_hits;
+}
+
+uint64_t FlowCache::GetMisses() const {
+    return m_misses;
+}
+
+uint64_t FlowCache::GetEvictions() const {
+    return m_evictions;
+}
+
+void FlowCache::ResetStats() {
+    m_hits = 0;
+    m_misses = 0;
+    m_evictions = 0;
+}
+
+} // namespace ns3
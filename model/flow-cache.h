@@ -0,0 +1,65 @@
+#ifndef FLOW_CACHE_H
+#define FLOW_CACHE_H
+
+#include "flow-key.h"
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * @brief Bounded exact-match cache from a flow's 5-tuple and DSCP to its queue index.
+ *
+ * The cache is set-associative: a key hashes to one set of WAYS entries and the eviction
+ * policy (LRU or CLOCK) picks the victim within that set. Invalidate() drops every entry
+ * in O(1) by advancing a generation number, so it can be called on each rule change.
+ */
+class FlowCache {
+public:
+    enum Policy {
+        LRU,
+        CLOCK
+    };
+
+    FlowCache();
+
+    void SetCapacity(uint32_t entries);
+    uint32_t GetCapacity() const;
+    void SetPolicy(Policy policy);
+    Policy GetPolicy() const;
+
+    bool Lookup(const FlowKey& key, uint32_t& queueIndex);
+    void Insert(const FlowKey& key, uint32_t queueIndex);
+    void Invalidate();
+
+    uint64_t GetHits() const;
+    uint64_t GetMisses() const;
+    uint64_t GetEvictions() const;
+    void ResetStats();
+
+private:
+    static const uint32_t WAYS = 8;
+
+    struct Entry {
+        FlowKey key;
+        uint32_t queueIndex;
+        uint32_t generation;  // entry is live only if equal to the cache's generation
+        uint32_t lastUse;     // LRU timestamp
+        bool referenced;      // CLOCK reference bit
+    };
+
+    uint32_t m_capacity;
+    uint32_t m_setMask;
+    Policy m_policy;
+    std::vector<Entry> m_entries;
+    std::vector<uint8_t> m_hands;
+    uint32_t m_generation;
+    uint32_t m_tick;
+    uint64_t m_hits;
+    uint64_t m_misses;
+    uint64_t m_evictions;
+};
+
+} // namespace ns3
+
+#endif /* FLOW_CACHE_H */
@@ -0,0 +1,244 @@
+#include "flow-key.h"
+#include "ns3/ipv4-queue-disc-item.h"
+#include "ns3/ipv6-queue-disc-item.h"
+
+namespace ns3 {
+
+namespace {
+
+const uint16_t PPP_PROTOCOL_IPV4 = 0x0021;
+const uint16_t PPP_PROTOCOL_IPV6 = 0x0057;
+const uint32_t PPP_HEADER_SIZE = 2;
+const uint32_t IPV4_MIN_HEADER_SIZE = 20;
+const uint32_t IPV4_MAX_HEADER_SIZE = 60;
+const uint32_t IPV6_HEADER_SIZE = 40;
+const uint32_t IPV6_MAX_EXTENSION_BYTES = 256;  // extension chains longer than this yield no ports
+const uint32_t PORTS_SIZE = 4;
+const uint8_t PROTOCOL_TCP = 6;
+const uint8_t PROTOCOL_UDP = 17;
+const uint8_t IPV6_HOP_BY_HOP = 0;
+const uint8_t IPV6_ROUTING = 43;
+const uint8_t IPV6_FRAGMENT = 44;
+const uint8_t IPV6_AUTHENTICATION = 51;
+const uint8_t IPV6_DESTINATION_OPTIONS = 60;
+
+inline uint16_t ReadU16(const uint8_t* b) {
+    return static_cast<uint16_t>((b[0] << 8) | b[1]);
+}
+
+inline uint32_t ReadU32(const uint8_t* b) {
+    return (static_cast<uint32_t>(b[0]) << 24) | (static_cast<uint32_t>(b[1]) << 16)
+         | (static_cast<uint32_t>(b[2]) << 8) | static_cast<uint32_t>(b[3]);
+}
+
+inline uint64_t ReadU64(const uint8_t* b) {
+    return (static_cast<uint64_t>(ReadU32(b)) << 32) | ReadU32(b + 4);
+}
+
+/**
+ * @brief Decodes an IPv6 header and walks its extension headers to the upper layer.
+ *
+ * @param ip Start of the IPv6 header.
+ * @param n Number of valid bytes from ip onwards.
+ * @param key The key to fill in.
+ */
+void ExtractIpv6(const uint8_t* ip, uint32_t n, FlowKey& key) {
+    if ((ip[0] >> 4) != 6) {
+        return;
+    }
+    key.valid = true;
+    key.ipv6 = true;
+    key.dscp = static_cast<uint8_t>(((ip[0] & 0x0f) << 2) | (ip[1] >> 6));
+    key.srcAddress6[0] = ReadU64(ip + 8);
+    key.srcAddress6[1] = ReadU64(ip + 16);
+    key.dstAddress6[0] = ReadU64(ip + 24);
+    key.dstAddress6[1] = ReadU64(ip + 32);
+
+    uint8_t next = ip[6];
+    uint32_t offset = IPV6_HEADER_SIZE;
+    bool firstFragment = true;
+    while (true) {
+        uint32_t length;
+        if (next == IPV6_HOP_BY_HOP || next == IPV6_ROUTING || next == IPV6_DESTINATION_OPTIONS) {
+            if (offset + 2 > n) {
+                break;
+            }
+            length = (ip[offset + 1] + 1) * 8u;
+        } else if (next == IPV6_FRAGMENT) {
+            if (offset + 8 > n) {
+                break;
+            }
+            firstFragment = (ReadU16(ip + offset + 2) & 0xfff8) == 0;
+            length = 8;
+        } else if (next == IPV6_AUTHENTICATION) {
+            if (offset + 2 > n) {
+                break;
+            }
+            length = (ip[offset + 1] + 2) * 4u;
+        } else {
+            key.protocol = next;
+            if (firstFragment && (next == PROTOCOL_UDP || next == PROTOCOL_TCP) && offset + PORTS_SIZE <= n) {
+                key.srcPort = ReadU16(ip + offset);
+                key.dstPort = ReadU16(ip + offset + 2);
+                key.hasPorts = true;
+            }
+            return;
+        }
+        next = ip[offset];
+        offset += length;
+    }
+    key.protocol = next;  // chain runs past the bytes copied: upper layer unknown
+}
+
+/**
+ * @brief Decodes an IPv4 header and the ports of the transport header that follows it.
+ *
+ * @param ip Start of the IPv4 header.
+ * @param n Number of valid bytes from ip onwards.
+ * @param key The key to fill in.
+ */
+void ExtractIpv4(const uint8_t* ip, uint32_t n, FlowKey& key) {
+    if (n < IPV4_MIN_HEADER_SIZE) {
+        return;
+    }
+    uint32_t ihl = (ip[0] & 0x0f) * 4u;
+    if ((ip[0] >> 4) != 4 || ihl < IPV4_MIN_HEADER_SIZE) {
+        return;
+    }
+    key.valid = true;
+    key.dscp = ip[1] >> 2;
+    key.protocol = ip[9];
+    key.srcAddress = ReadU32(ip + 12);
+    key.dstAddress = ReadU32(ip + 16);
+
+    bool firstFragment = (ReadU16(ip + 6) & 0x1fff) == 0;
+    if (firstFragment && (key.protocol == PROTOCOL_UDP || key.protocol == PROTOCOL_TCP)
+        && n >= ihl + PORTS_SIZE) {
+        key.srcPort = ReadU16(ip + ihl);
+        key.dstPort = ReadU16(ip + ihl + 2);
+        key.hasPorts = true;
+    }
+}
+
+inline void WriteU16(uint8_t* b, uint16_t value) {
+    b[0] = static_cast<uint8_t>(value >> 8);
+    b[1] = static_cast<uint8_t>(value);
+}
+
+inline void WriteU32(uint8_t* b, uint32_t value) {
+    WriteU16(b, static_cast<uint16_t>(value >> 16));
+    WriteU16(b + 2, static_cast<uint16_t>(value));
+}
+
+} // namespace
+
+/**
+ * @brief Extracts the classification fields from a PPP-framed IPv4 or IPv6 packet.
+ *
+ * Copies only the leading header bytes (PPP, IPv4 including options or IPv6 with its
+ * extension headers, and the first four bytes of the transport header) into a stack
+ * buffer and decodes them in place, instead of copying the packet and deserializing
+ * header objects. Packets that carry neither IPv4 nor IPv6 yield a key with
+ * valid == false.
+ *
+ * @param p Pointer to the packet to be parsed.
+ * @return The extracted key.
+ */
+FlowKey FlowKey::Extract(Ptr<const Packet> p) {
+    FlowKey key;
+    key.length = p->GetSize();
+
+    uint8_t buf[PPP_HEADER_SIZE + IPV6_HEADER_SIZE + IPV6_MAX_EXTENSION_BYTES + PORTS_SIZE];
+    uint32_t n = p->CopyData(buf, PPP_HEADER_SIZE + IPV4_MAX_HEADER_SIZE + PORTS_SIZE);
+    if (n >= PPP_HEADER_SIZE + IPV6_HEADER_SIZE && ReadU16(buf) == PPP_PROTOCOL_IPV6) {
+        if (n == PPP_HEADER_SIZE + IPV4_MAX_HEADER_SIZE + PORTS_SIZE) {
+            n = p->CopyData(buf, sizeof(buf));
+        }
+        ExtractIpv6(buf + PPP_HEADER_SIZE, n - PPP_HEADER_SIZE, key);
+    } else if (n >= PPP_HEADER_SIZE && ReadU16(buf) == PPP_PROTOCOL_IPV4) {
+        ExtractIpv4(buf + PPP_HEADER_SIZE, n - PPP_HEADER_SIZE, key);
+    }
+    return key;
+}
+
+/**
+ * @brief Extracts the classification fields from an item handed over by the traffic
+ * control layer.
+ *
+ * Such items carry the IP header as an object next to a packet that starts at the
+ * transport header (or at the IPv6 extension headers). The header fields are written
+ * into the same stack buffer layout Extract(Ptr<const Packet>) decodes, followed by the
+ * leading payload bytes, so both paths share one decoder. Items that are neither
+ * Ipv4QueueDiscItem nor Ipv6QueueDiscItem yield a key with valid == false.
+ *
+ * @param item The item to be parsed.
+ * @return The extracted key.
+ */
+FlowKey FlowKey::Extract(const QueueDiscItem& item) {
+    FlowKey key;
+    key.length = item.GetSize();
+
+    uint8_t buf[IPV6_HEADER_SIZE + IPV6_MAX_EXTENSION_BYTES + PORTS_SIZE] = {};
+    if (auto ipv4 = dynamic_cast<const Ipv4QueueDiscItem*>(&item)) {
+        const Ipv4Header& header = ipv4->GetHeader();
+        buf[0] = 0x45;
+        buf[1] = header.GetTos();
+        WriteU16(buf + 6, header.GetFragmentOffset() / 8);
+        buf[9] = header.GetProtocol();
+        WriteU32(buf + 12, header.GetSource().Get());
+        WriteU32(buf + 16, header.GetDestination().Get());
+        uint32_t n = item.GetPacket()->CopyData(buf + IPV4_MIN_HEADER_SIZE, PORTS_SIZE);
+        ExtractIpv4(buf, IPV4_MIN_HEADER_SIZE + n, key);
+    } else if (auto ipv6 = dynamic_cast<const Ipv6QueueDiscItem*>(&item)) {
+        const Ipv6Header& header = ipv6->GetHeader();
+        buf[0] = static_cast<uint8_t>(0x60 | (header.GetTrafficClass() >> 4));
+        buf[1] = static_cast<uint8_t>(header.GetTrafficClass() << 4);
+        buf[6] = header.GetNextHeader();
+        header.GetSource().GetBytes(buf + 8);
+        header.GetDestination().GetBytes(buf + 24);
+        uint32_t n = item.GetPacket()->CopyData(buf + IPV6_HEADER_SIZE, sizeof(buf) - IPV6_HEADER_SIZE);
+        ExtractIpv6(buf, IPV6_HEADER_SIZE + n, key);
+    }
+    return key;
+}
+
+/**
+ * @brief Hashes the 5-tuple and DSCP, the fields classification depends on.
+ *
+ * @return A well-mixed 32-bit hash of the key.
+ */
+uint32_t FlowKey::Hash() const {
+    uint64_t h = (static_cast<uint64_t>(srcAddress) << 32) | dstAddress;
+    if (ipv6) {
+        h = (srcAddress6[0] * 0x9e3779b97f4a7c15ULL) ^ srcAddress6[1]
+          ^ ((dstAddress6[0] * 0x9e3779b97f4a7c15ULL) >> 1) ^ (dstAddress6[1] << 1);
+    }
+    h ^= (static_cast<uint64_t>(srcPort) << 48) | (static_cast<uint64_t>(dstPort) << 32)
+       | (static_cast<uint64_t>(protocol) << 16) | (static_cast<uint64_t>(dscp) << 8)
+       | (ipv6 ? 4u : 0u) | (hasPorts ? 2u : 0u) | (valid ? 1u : 0u);
+    // 64-bit finalizer from MurmurHash3
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb3fe1a85ec53ULL;
+    h ^= h >> 33;
+    return static_cast<uint32_t>(h);
+}
+
+/**
+ * @brief Checks whether two keys agree on every field classification depends on.
+ *
+ * @param other The key to compare with.
+ * @return True if both keys have the same 5-tuple, DSCP and parse flags.
+ */
+bool FlowKey::SameFlow(const FlowKey& other) const {
+    return srcAddress == other.srcAddress && dstAddress == other.dstAddress
+        && ipv6 == other.ipv6
+        && srcAddress6[0] == other.srcAddress6[0] && srcAddress6[1] == other.srcAddress6[1]
+        && dstAddress6[0] == other.dstAddress6[0] && dstAddress6[1] == other.dstAddress6[1]
+        && srcPort == other.srcPort && dstPort == other.dstPort
+        && protocol == other.protocol && dscp == other.dscp
+        && hasPorts == other.hasPorts && valid == other.valid;
+}
+
+} // namespace ns3
@@ -0,0 +1,43 @@
+#ifndef FLOW_KEY_H
+#define FLOW_KEY_H
+
+#include "ns3/packet.h"
+#include "ns3/ptr.h"
+#include "ns3/queue-item.h"
+#include <cstdint>
+
+namespace ns3 {
+
+/**
+ * @brief Header fields used for classification, extracted once per packet.
+ *
+ * DiffServ::DoEnqueue builds a FlowKey from the PPP-framed packet handed over by
+ * the device, DiffServQueueDisc from the item handed over by the traffic control layer,
+ * and every TrafficClass, Filter and FilterElement matches against it,
+ * so the packet itself is never copied or re-parsed during classification.
+ * IPv4 addresses are stored in host byte order, as returned by Ipv4Address::Get();
+ * IPv6 addresses as two host-order 64-bit halves, most significant half first.
+ */
+struct FlowKey {
+    uint32_t srcAddress = 0;
+    uint32_t dstAddress = 0;
+    uint64_t srcAddress6[2] = {0, 0};
+    uint64_t dstAddress6[2] = {0, 0};
+    uint16_t srcPort = 0;
+    uint16_t dstPort = 0;
+    uint8_t protocol = 0;   // IPv4 protocol, or IPv6 upper-layer header after extension headers
+    uint8_t dscp = 0;
+    bool hasPorts = false;  // set for unfragmented (or first-fragment) UDP and TCP
+    bool valid = false;     // set once an IPv4 or IPv6 header has been parsed
+    bool ipv6 = false;      // set if that header was IPv6
+    uint32_t length = 0;    // size of the packet as queued, in bytes
+
+    static FlowKey Extract(Ptr<const Packet> p);
+    static FlowKey Extract(const QueueDiscItem& item);
+    uint32_t Hash() const;
+    bool SameFlow(const FlowKey& other) const;
+};
+
+} // namespace ns3
+
+#endif /* FLOW_KEY_H */
@@ -0,0 +1,97 @@
+#include "log-histogram.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+LogHistogram::LogHistogram() : m_totalWeight(0), m_max(0), m_weightedSum(0) {
+}
+
+/**
+ * @brief Adds a sample.
+ *
+ * @param value The sample, e.g. a sojourn time in nanoseconds or a queue length.
+ * @param weight How much the sample counts, e.g. 1 per packet or the nanoseconds the
+ *               queue held this length. Zero weights are ignored.
+ */
+void LogHistogram::Record(uint64_t value, uint64_t weight) {
+    if (weight == 0) {
+        return;
+    }
+    if (m_buckets.empty()) {
+        m_buckets.assign(BUCKETS, 0);
+    }
+    m_buckets[BucketOf(value)] += weight;
+    m_totalWeight += weight;
+    m_weightedSum += static_cast<double>(value) * weight;
+    m_max = std::max(m_max, value);
+}
+
+void LogHistogram::Reset() {
+    std::fill(m_buckets.begin(), m_buckets.end(), 0);
+    m_totalWeight = 0;
+    m_max = 0;
+    m_weightedSum = 0;
+}
+
+uint64_t LogHistogram::GetTotalWeight() const {
+    return m_totalWeight;
+}
+
+uint64_t LogHistogram::GetMax() const {
+    return m_max;
+}
+
+double LogHistogram::GetMean() const {
+    return m_totalWeight ? m_weightedSum / m_totalWeight : 0;
+}
+
+/**
+ * @brief Returns the smallest value such that the given share of the weight is at or below it.
+ *
+ * Values are reported as the upper bound of their bucket, capped at the largest sample,
+ * so percentiles never understate the recorded values.
+ *
+ * @param percentile The share, in percent, e.g. 99.9.
+ * @return The percentile, or 0 if nothing was recorded.
+ */
+uint64_t LogHistogram::GetPercentile(double percentile) const {
+    if (m_totalWeight == 0) {
+        return 0;
+    }
+    double clamped = std::clamp(percentile, 0.0, 100.0);
+    uint64_t rank = std::max<uint64_t>(1, std::ceil(clamped / 100 * m_totalWeight));
+    uint64_t seen = 0;
+    for (uint32_t bucket = 0; bucket < BUCKETS; ++bucket) {
+        seen += m_buckets[bucket];
+        if (seen >= rank) {
+            return std::min(UpperBound(bucket), m_max);
+        }
+    }
+    return m_max;
+}
+
+/**
+ * @brief Maps a value to its bucket in constant time.
+ */
+uint32_t LogHistogram::BucketOf(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return value;
+    }
+    uint32_t shift = 63 - __builtin_clzll(value) - SUB_BITS + 1;
+    return SUB_BUCKETS + (shift - 1) * HALF_BUCKETS + (value >> shift) - HALF_BUCKETS;
+}
+
+/**
+ * @brief Returns the largest value that falls in a bucket.
+ */
+uint64_t LogHistogram::UpperBound(uint32_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    uint32_t shift = (bucket - SUB_BUCKETS) / HALF_BUCKETS + 1;
+    uint64_t top = HALF_BUCKETS + (bucket - SUB_BUCKETS) % HALF_BUCKETS;
+    return ((top + 1) << shift) - 1;
+}
+
+} // namespace ns3
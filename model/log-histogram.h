@@ -0,0 +1,49 @@
+#ifndef LOG_HISTOGRAM_H
+#define LOG_HISTOGRAM_H
+
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * @brief HDR-style histogram of non-negative integer samples with log-spaced buckets.
+ *
+ * Values below 2^SUB_BITS get a bucket each; above that every power-of-two range is
+ * split into 2^(SUB_BITS-1) equal buckets, so a reported value exceeds the recorded
+ * one by at most 1/32 over the whole 64-bit range. Recording is O(1); the buckets
+ * (about 15 KB) are allocated by the first sample, so histograms that never see one,
+ * like those of idle traffic classes, cost only a few words. Samples carry a weight,
+ * which gives time-weighted distributions when the weight is the time a value was held.
+ */
+class LogHistogram {
+public:
+    static constexpr uint32_t SUB_BITS = 6;
+
+    LogHistogram();
+
+    void Record(uint64_t value, uint64_t weight = 1);
+    void Reset();
+
+    uint64_t GetTotalWeight() const;
+    uint64_t GetMax() const;
+    double GetMean() const;
+    uint64_t GetPercentile(double percentile) const;
+
+private:
+    static constexpr uint32_t SUB_BUCKETS = 1u << SUB_BITS;
+    static constexpr uint32_t HALF_BUCKETS = SUB_BUCKETS / 2;
+    static constexpr uint32_t BUCKETS = SUB_BUCKETS + (64 - SUB_BITS) * HALF_BUCKETS;
+
+    static uint32_t BucketOf(uint64_t value);
+    static uint64_t UpperBound(uint32_t bucket);
+
+    std::vector<uint64_t> m_buckets;  // empty until the first sample
+    uint64_t m_totalWeight;
+    uint64_t m_max;
+    double m_weightedSum;
+};
+
+} // namespace ns3
+
+#endif /* LOG_HISTOGRAM_H */
@@ -0,0 +1,90 @@
+#include "packet-marker.h"
+#include "ns3/log.h"
+#include "ns3/ppp-header.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv6-header.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("PacketMarker");
+
+namespace {
+
+const uint16_t PPP_PROTOCOL_IPV4 = 0x0021;
+const uint16_t PPP_PROTOCOL_IPV6 = 0x0057;
+
+} // namespace
+
+/**
+ * @brief Sets the DSCP of a packet, keeping its ECN bits.
+ *
+ * The IPv4 checksum is recomputed. Packets that carry neither IPv4 nor IPv6 are left
+ * untouched.
+ *
+ * @param p The packet, starting with its PPP header.
+ * @param dscp The new DSCP value (0-63).
+ * @return True if the packet was remarked.
+ */
+bool PacketMarker::SetDscp(Ptr<Packet> p, uint8_t dscp) {
+    PppHeader ppp;
+    if (p->RemoveHeader(ppp) == 0) {
+        return false;
+    }
+    bool marked = true;
+    if (ppp.GetProtocol() == PPP_PROTOCOL_IPV4) {
+        Ipv4Header ip;
+        p->RemoveHeader(ip);
+        ip.SetDscp(static_cast<Ipv4Header::DscpType>(dscp));
+        ip.EnableChecksum();
+        p->AddHeader(ip);
+    } else if (ppp.GetProtocol() == PPP_PROTOCOL_IPV6) {
+        Ipv6Header ip;
+        p->RemoveHeader(ip);
+        ip.SetTrafficClass(static_cast<uint8_t>((dscp << 2) | (ip.GetTrafficClass() & 0x03)));
+        p->AddHeader(ip);
+    } else {
+        marked = false;
+    }
+    p->AddHeader(ppp);
+    NS_LOG_LOGIC("Packet " << (marked ? "remarked with DSCP " : "not remarked, DSCP ") << +dscp);
+    return marked;
+}
+
+/**
+ * @brief Marks an ECN-capable packet Congestion Experienced.
+ *
+ * The IPv4 checksum is recomputed. Packets that are not ECN-capable are left untouched.
+ *
+ * @param p The packet, starting with its PPP header.
+ * @return True if the packet now carries CE, false if the sender does not support ECN.
+ */
+bool PacketMarker::SetEcnCe(Ptr<Packet> p) {
+    PppHeader ppp;
+    if (p->RemoveHeader(ppp) == 0) {
+        return false;
+    }
+    bool marked = false;
+    if (ppp.GetProtocol() == PPP_PROTOCOL_IPV4) {
+        Ipv4Header ip;
+        p->RemoveHeader(ip);
+        if (ip.GetEcn() != Ipv4Header::ECN_NotECT) {
+            ip.SetEcn(Ipv4Header::ECN_CE);
+            ip.EnableChecksum();
+            marked = true;
+        }
+        p->AddHeader(ip);
+    } else if (ppp.GetProtocol() == PPP_PROTOCOL_IPV6) {
+        Ipv6Header ip;
+        p->RemoveHeader(ip);
+        if ((ip.GetTrafficClass() & 0x03) != 0) {
+            ip.SetTrafficClass(ip.GetTrafficClass() | 0x03);
+            marked = true;
+        }
+        p->AddHeader(ip);
+    }
+    p->AddHeader(ppp);
+    NS_LOG_LOGIC("Packet " << (marked ? "marked CE" : "not ECN-capable"));
+    return marked;
+}
+
+} // namespace ns3
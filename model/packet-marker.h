@@ -0,0 +1,21 @@
+#ifndef PACKET_MARKER_H
+#define PACKET_MARKER_H
+
+#include "ns3/packet.h"
+#include "ns3/ptr.h"
+#include <cstdint>
+
+namespace ns3 {
+
+/**
+ * @brief Rewrites the DiffServ and ECN fields of PPP-framed IPv4 and IPv6 packets held in a queue.
+ */
+class PacketMarker {
+public:
+    static bool SetDscp(Ptr<Packet> p, uint8_t dscp);
+    static bool SetEcnCe(Ptr<Packet> p);
+};
+
+} // namespace ns3
+
+#endif /* PACKET_MARKER_H */
@@ -0,0 +1,115 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * @brief FIFO stored in one contiguous, power-of-two sized array.
+ *
+ * Reserve() preallocates the slots for an expected number of elements, up to
+ * PREALLOCATE_LIMIT; beyond that the ring doubles when Push() finds it full, so a class
+ * configured for a million packets does not pin its worst case in memory. Once the ring
+ * has reached its working size, Push() and Pop() never allocate.
+ */
+template <typename T>
+class RingBuffer {
+public:
+    static constexpr uint32_t PREALLOCATE_LIMIT = 4096;
+
+    RingBuffer() : m_head(0), m_size(0) {}
+
+    /**
+     * @brief Sizes the ring for up to the given number of elements.
+     *
+     * Never drops elements: the ring keeps room for the ones it holds.
+     *
+     * @param count The largest number of elements the ring is expected to hold.
+     */
+    void Reserve(uint32_t count) {
+        uint32_t capacity = RoundUp(std::max(std::min(count, PREALLOCATE_LIMIT), m_size));
+        if (capacity != m_slots.size()) {
+            Reallocate(capacity);
+        }
+    }
+
+    uint32_t GetCapacity() const {
+        return m_slots.size();
+    }
+
+    uint32_t GetSize() const {
+        return m_size;
+    }
+
+    bool IsEmpty() const {
+        return m_size == 0;
+    }
+
+    void Push(T item) {
+        if (m_size == m_slots.size()) {
+            Reallocate(RoundUp(m_size + 1));
+        }
+        m_slots[(m_head + m_size) & (m_slots.size() - 1)] = std::move(item);
+        m_size++;
+    }
+
+    /**
+     * @brief Removes the front element and returns it; the slot is reset, so the ring
+     * holds no references to elements it no longer contains.
+     */
+    T Pop() {
+        T item = std::move(m_slots[m_head]);
+        m_slots[m_head] = T();
+        m_head = (m_head + 1) & (m_slots.size() - 1);
+        m_size--;
+        return item;
+    }
+
+    T& Front() {
+        return m_slots[m_head];
+    }
+
+    const T& Front() const {
+        return m_slots[m_head];
+    }
+
+    /**
+     * @brief Returns the element at the given position, counted from the front.
+     */
+    const T& operator[](uint32_t i) const {
+        return m_slots[(m_head + i) & (m_slots.size() - 1)];
+    }
+
+private:
+    static uint32_t RoundUp(uint32_t count) {
+        uint32_t capacity = 1;
+        while (capacity < count) {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+    /**
+     * @brief Moves the elements to a new array of the given size, front first.
+     */
+    void Reallocate(uint32_t capacity) {
+        std::vector<T> slots(capacity);
+        for (uint32_t i = 0; i < m_size; ++i) {
+            slots[i] = std::move(m_slots[(m_head + i) & (m_slots.size() - 1)]);
+        }
+        m_slots.swap(slots);
+        m_head = 0;
+    }
+
+    std::vector<T> m_slots;
+    uint32_t m_head;
+    uint32_t m_size;
+};
+
+} // namespace ns3
+
+#endif /* RING_BUFFER_H */
@@ -0,0 +1,386 @@
+#include "rule-table.h"
+#include "traffic-class.h"
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RULE_TABLE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace ns3 {
+
+namespace {
+
+const uint32_t NEEDS_VALID = 1;
+const uint32_t NEEDS_PORTS = 2;
+const uint32_t NEEDS_IPV4 = 4;
+const uint32_t NEEDS_IPV6 = 8;
+const uint32_t NEVER_MATCHES = 16;  // no FlowKey carries this flag, used for padding rows
+const int32_t MAX_PORT = 0xffff;
+
+/**
+ * @brief Packet fields of one burst, laid out column by column like the rule table.
+ */
+struct BurstColumns {
+    uint32_t src[RuleTable::BURST];
+    uint32_t dst[RuleTable::BURST];
+    int32_t srcPort[RuleTable::BURST];
+    int32_t dstPort[RuleTable::BURST];
+    uint32_t proto[RuleTable::BURST];
+    uint32_t flags[RuleTable::BURST];
+    uint16_t pending[RuleTable::BURST];
+    uint32_t count;
+};
+
+} // namespace
+
+RuleTable::RuleTable()
+    : m_built(false), m_complete(false), m_rows(0), m_noMatch(0), m_kernel(GetBestKernel()) {
+}
+
+void RuleTable::Clear() {
+    m_built = false;
+    m_complete = false;
+    m_rows = 0;
+    m_noMatch = 0;
+    for (std::vector<uint32_t>* column : {&m_srcValue, &m_srcMask, &m_dstValue, &m_dstMask,
+                                          &m_protoValue, &m_protoMask, &m_needs, &m_class}) {
+        column->clear();
+    }
+    for (std::vector<int32_t>* column : {&m_srcPortLo, &m_srcPortHi, &m_dstPortLo, &m_dstPortHi}) {
+        column->clear();
+    }
+}
+
+bool RuleTable::IsBuilt() const {
+    return m_built;
+}
+
+/**
+ * @brief Tells whether every configured filter could be expressed as a row.
+ *
+ * Filters with elements other than IPv4 addresses and masks, ports, protocols and next
+ * headers (e.g. IPv6 prefixes or custom FilterElement subclasses) make the table
+ * incomplete, and it must not be used.
+ */
+bool RuleTable::IsComplete() const {
+    return m_complete;
+}
+
+uint32_t RuleTable::GetRowCount() const {
+    return m_rows;
+}
+
+void RuleTable::SetKernel(Kernel kernel) {
+    m_kernel = std::min(kernel, GetBestKernel());
+}
+
+RuleTable::Kernel RuleTable::GetKernel() const {
+    return m_kernel;
+}
+
+/**
+ * @brief Returns the widest kernel the CPU running the simulation supports.
+ */
+RuleTable::Kernel RuleTable::GetBestKernel() {
+#ifdef RULE_TABLE_X86_KERNELS
+    if (__builtin_cpu_supports("avx2")) {
+        return AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return SSE4;
+    }
+#endif
+    return SCALAR;
+}
+
+/**
+ * @brief Builds one row per filter of the given classes, in class order.
+ *
+ * Classes after the first one that accepts everything can never win and get no rows.
+ * The row count is padded to a multiple of LANES with rows that never match.
+ *
+ * @param classes The traffic classes, in classification order.
+ */
+void RuleTable::Build(const std::vector<Ptr<TrafficClass>>& classes) {
+    Clear();
+    m_noMatch = classes.size();
+    m_complete = true;
+
+    static const std::vector<FilterElement*> matchAll;
+    bool catchAll = false;
+    for (uint32_t i = 0; i < classes.size() && !catchAll; ++i) {
+        const std::vector<Filter*>& filters = classes[i]->GetFilters();
+        if (filters.empty()) {
+            AddRow(i, matchAll);
+            catchAll = true;
+        }
+        for (Filter* filter : filters) {
+            AddRow(i, filter->elements);
+            catchAll = catchAll || filter->elements.empty();
+        }
+    }
+
+    uint32_t realRows = m_class.size();
+    uint32_t paddedRows = (realRows + LANES - 1) / LANES * LANES;
+    for (uint32_t r = realRows; r < paddedRows; ++r) {
+        AddRow(m_noMatch, matchAll);
+        m_needs.back() = NEVER_MATCHES;
+    }
+    m_rows = m_class.size();
+    m_built = true;
+}
+
+/**
+ * @brief Folds the elements of one filter into a single row.
+ *
+ * Several elements on the same field are intersected; a filter whose elements can never
+ * hold together (e.g. two different exact ports) produces no row.
+ */
+void RuleTable::AddRow(uint32_t classIndex, const std::vector<FilterElement*>& elements) {
+    uint32_t srcValue = 0, srcMask = 0, dstValue = 0, dstMask = 0;
+    int32_t srcPortLo = 0, srcPortHi = MAX_PORT, dstPortLo = 0, dstPortHi = MAX_PORT;
+    uint32_t protoValue = 0, protoMask = 0, needs = 0;
+
+    auto fold = [](uint32_t& value, uint32_t& mask, const MatchSpec& spec) {
+        if ((value & spec.mask) != (spec.value & mask)) {
+            return false;
+        }
+        value |= spec.value;
+        mask |= spec.mask;
+        return true;
+    };
+    auto narrow = [](int32_t& lo, int32_t& hi, uint32_t specLo, uint32_t specHi) {
+        lo = std::max<int64_t>(lo, specLo);
+        hi = std::min<int64_t>(hi, specHi);
+        return lo <= hi;
+    };
+
+    for (FilterElement* element : elements) {
+        MatchSpec spec = element->GetSpec();
+        bool possible = true;
+        switch (spec.field) {
+        case MatchField::SrcAddress:
+            possible = fold(srcValue, srcMask, spec);
+            needs |= NEEDS_VALID | NEEDS_IPV4;
+            break;
+        case MatchField::DstAddress:
+            possible = fold(dstValue, dstMask, spec);
+            needs |= NEEDS_VALID | NEEDS_IPV4;
+            break;
+        case MatchField::SrcPort:
+            possible = narrow(srcPortLo, srcPortHi, spec.value, spec.high);
+            needs |= NEEDS_VALID | NEEDS_PORTS;
+            break;
+        case MatchField::DstPort:
+            possible = narrow(dstPortLo, dstPortHi, spec.value, spec.high);
+            needs |= NEEDS_VALID | NEEDS_PORTS;
+            break;
+        case MatchField::Protocol:
+            possible = fold(protoValue, protoMask, spec);
+            needs |= NEEDS_VALID | NEEDS_IPV4;
+            break;
+        case MatchField::NextHeader:
+            possible = fold(protoValue, protoMask, spec);
+            needs |= NEEDS_VALID | NEEDS_IPV6;
+            break;
+        default:
+            m_complete = false;
+            possible = false;
+            break;
+        }
+        if (!possible) {
+            return;
+        }
+    }
+
+    m_srcValue.push_back(srcValue);
+    m_srcMask.push_back(srcMask);
+    m_dstValue.push_back(dstValue);
+    m_dstMask.push_back(dstMask);
+    m_srcPortLo.push_back(srcPortLo);
+    m_srcPortHi.push_back(srcPortHi);
+    m_dstPortLo.push_back(dstPortLo);
+    m_dstPortHi.push_back(dstPortHi);
+    m_protoValue.push_back(protoValue);
+    m_protoMask.push_back(protoMask);
+    m_needs.push_back(needs);
+    m_class.push_back(classIndex);
+}
+
+namespace {
+
+/**
+ * @brief Column pointers of the rule table, handed to the kernels.
+ */
+struct RowColumns {
+    const uint32_t* srcValue;
+    const uint32_t* srcMask;
+    const uint32_t* dstValue;
+    const uint32_t* dstMask;
+    const int32_t* srcPortLo;
+    const int32_t* srcPortHi;
+    const int32_t* dstPortLo;
+    const int32_t* dstPortHi;
+    const uint32_t* protoValue;
+    const uint32_t* protoMask;
+    const uint32_t* needs;
+    const uint32_t* classIndex;
+    uint32_t rows;
+};
+
+/**
+ * @brief Records the first matching row of a packet and drops it from the pending list.
+ *
+ * @param bits Mask of the rows of the block starting at row the packet matches; the
+ *             lowest set bit is the first matching row.
+ * @return True if the packet matched, in which case pending[k] now holds another packet.
+ */
+inline bool Resolve(const RowColumns& rows, uint32_t row, uint32_t bits, uint32_t k,
+                    BurstColumns& burst, uint32_t* out) {
+    if (bits == 0) {
+        return false;
+    }
+    out[burst.pending[k]] = rows.classIndex[row + __builtin_ctz(bits)];
+    burst.pending[k] = burst.pending[--burst.count];
+    return true;
+}
+
+void ScalarKernel(const RowColumns& rows, BurstColumns& burst, uint32_t* out) {
+    for (uint32_t r = 0; r < rows.rows && burst.count > 0; ++r) {
+        for (uint32_t k = 0; k < burst.count;) {
+            uint32_t j = burst.pending[k];
+            bool match = (burst.src[j] & rows.srcMask[r]) == rows.srcValue[r]
+                      && (burst.dst[j] & rows.dstMask[r]) == rows.dstValue[r]
+                      && burst.srcPort[j] >= rows.srcPortLo[r] && burst.srcPort[j] <= rows.srcPortHi[r]
+                      && burst.dstPort[j] >= rows.dstPortLo[r] && burst.dstPort[j] <= rows.dstPortHi[r]
+                      && (burst.proto[j] & rows.protoMask[r]) == rows.protoValue[r]
+                      && (rows.needs[r] & ~burst.flags[j]) == 0;
+            if (!Resolve(rows, r, match ? 1 : 0, k, burst, out)) {
+                ++k;
+            }
+        }
+    }
+}
+
+#ifdef RULE_TABLE_X86_KERNELS
+
+#define LOAD_ROWS_128(column) _mm_loadu_si128(reinterpret_cast<const __m128i*>((column) + r))
+#define LOAD_ROWS_256(column) _mm256_loadu_si256(reinterpret_cast<const __m256i*>((column) + r))
+
+__attribute__((target("sse4.1")))
+void Sse4Kernel(const RowColumns& rows, BurstColumns& burst, uint32_t* out) {
+    const __m128i zero = _mm_setzero_si128();
+    for (uint32_t r = 0; r < rows.rows && burst.count > 0; r += 4) {
+        __m128i srcValue = LOAD_ROWS_128(rows.srcValue), srcMask = LOAD_ROWS_128(rows.srcMask);
+        __m128i dstValue = LOAD_ROWS_128(rows.dstValue), dstMask = LOAD_ROWS_128(rows.dstMask);
+        __m128i srcLo = LOAD_ROWS_128(rows.srcPortLo), srcHi = LOAD_ROWS_128(rows.srcPortHi);
+        __m128i dstLo = LOAD_ROWS_128(rows.dstPortLo), dstHi = LOAD_ROWS_128(rows.dstPortHi);
+        __m128i protoValue = LOAD_ROWS_128(rows.protoValue), protoMask = LOAD_ROWS_128(rows.protoMask);
+        __m128i needs = LOAD_ROWS_128(rows.needs);
+
+        for (uint32_t k = 0; k < burst.count;) {
+            uint32_t j = burst.pending[k];
+            __m128i sp = _mm_set1_epi32(burst.srcPort[j]);
+            __m128i dp = _mm_set1_epi32(burst.dstPort[j]);
+            __m128i m = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(burst.src[j]), srcMask), srcValue);
+            m = _mm_and_si128(m, _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(burst.dst[j]), dstMask), dstValue));
+            m = _mm_andnot_si128(_mm_or_si128(_mm_cmpgt_epi32(srcLo, sp), _mm_cmpgt_epi32(sp, srcHi)), m);
+            m = _mm_andnot_si128(_mm_or_si128(_mm_cmpgt_epi32(dstLo, dp), _mm_cmpgt_epi32(dp, dstHi)), m);
+            m = _mm_and_si128(m, _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(burst.proto[j]), protoMask), protoValue));
+            m = _mm_and_si128(m, _mm_cmpeq_epi32(_mm_andnot_si128(_mm_set1_epi32(burst.flags[j]), needs), zero));
+            uint32_t bits = _mm_testz_si128(m, m) ? 0 : _mm_movemask_ps(_mm_castsi128_ps(m));
+            if (!Resolve(rows, r, bits, k, burst, out)) {
+                ++k;
+            }
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+void Avx2Kernel(const RowColumns& rows, BurstColumns& burst, uint32_t* out) {
+    const __m256i zero = _mm256_setzero_si256();
+    for (uint32_t r = 0; r < rows.rows && burst.count > 0; r += 8) {
+        __m256i srcValue = LOAD_ROWS_256(rows.srcValue), srcMask = LOAD_ROWS_256(rows.srcMask);
+        __m256i dstValue = LOAD_ROWS_256(rows.dstValue), dstMask = LOAD_ROWS_256(rows.dstMask);
+        __m256i srcLo = LOAD_ROWS_256(rows.srcPortLo), srcHi = LOAD_ROWS_256(rows.srcPortHi);
+        __m256i dstLo = LOAD_ROWS_256(rows.dstPortLo), dstHi = LOAD_ROWS_256(rows.dstPortHi);
+        __m256i protoValue = LOAD_ROWS_256(rows.protoValue), protoMask = LOAD_ROWS_256(rows.protoMask);
+        __m256i needs = LOAD_ROWS_256(rows.needs);
+
+        for (uint32_t k = 0; k < burst.count;) {
+            uint32_t j = burst.pending[k];
+            __m256i sp = _mm256_set1_epi32(burst.srcPort[j]);
+            __m256i dp = _mm256_set1_epi32(burst.dstPort[j]);
+            __m256i m = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(burst.src[j]), srcMask), srcValue);
+            m = _mm256_and_si256(m, _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(burst.dst[j]), dstMask), dstValue));
+            m = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpgt_epi32(srcLo, sp), _mm256_cmpgt_epi32(sp, srcHi)), m);
+            m = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpgt_epi32(dstLo, dp), _mm256_cmpgt_epi32(dp, dstHi)), m);
+            m = _mm256_and_si256(m, _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(burst.proto[j]), protoMask), protoValue));
+            m = _mm256_and_si256(m, _mm256_cmpeq_epi32(_mm256_andnot_si256(_mm256_set1_epi32(burst.flags[j]), needs), zero));
+            uint32_t bits = _mm256_movemask_ps(_mm256_castsi256_ps(m));
+            if (!Resolve(rows, r, bits, k, burst, out)) {
+                ++k;
+            }
+        }
+    }
+}
+
+#undef LOAD_ROWS_128
+#undef LOAD_ROWS_256
+
+#endif // RULE_TABLE_X86_KERNELS
+
+} // namespace
+
+/**
+ * @brief Classifies a burst of packets against the rule table.
+ *
+ * Packets are processed in bursts of up to BURST: their keys are transposed into
+ * columns, then each block of rows is loaded once and compared against every packet of
+ * the burst that has not matched yet.
+ *
+ * @param keys Flow keys of the packets to classify.
+ * @param out Receives the class index of each packet, or the number of classes if none
+ *            matches. Must be at least as long as keys.
+ */
+void RuleTable::Classify(std::span<const FlowKey> keys, std::span<uint32_t> out) const {
+    RowColumns rows = {m_srcValue.data(), m_srcMask.data(), m_dstValue.data(), m_dstMask.data(),
+                       m_srcPortLo.data(), m_srcPortHi.data(), m_dstPortLo.data(), m_dstPortHi.data(),
+                       m_protoValue.data(), m_protoMask.data(), m_needs.data(), m_class.data(), m_rows};
+    BurstColumns burst;
+
+    for (size_t base = 0; base < keys.size(); base += BURST) {
+        uint32_t n = std::min<size_t>(BURST, keys.size() - base);
+        for (uint32_t j = 0; j < n; ++j) {
+            const FlowKey& key = keys[base + j];
+            burst.src[j] = key.srcAddress;
+            burst.dst[j] = key.dstAddress;
+            burst.srcPort[j] = key.srcPort;
+            burst.dstPort[j] = key.dstPort;
+            burst.proto[j] = key.protocol;
+            burst.flags[j] = (key.valid ? NEEDS_VALID | (key.ipv6 ? NEEDS_IPV6 : NEEDS_IPV4) : 0)
+                           | (key.hasPorts ? NEEDS_PORTS : 0);
+            burst.pending[j] = j;
+            out[base + j] = m_noMatch;
+        }
+        burst.count = n;
+
+        uint32_t* burstOut = out.data() + base;
+        switch (m_kernel) {
+#ifdef RULE_TABLE_X86_KERNELS
+        case AVX2:
+            Avx2Kernel(rows, burst, burstOut);
+            break;
+        case SSE4:
+            Sse4Kernel(rows, burst, burstOut);
+            break;
+#endif
+        default:
+            ScalarKernel(rows, burst, burstOut);
+            break;
+        }
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,75 @@
+#ifndef RULE_TABLE_H
+#define RULE_TABLE_H
+
+#include "ns3/ptr.h"
+#include "flow-key.h"
+#include "filter-element.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ns3 {
+
+class TrafficClass;
+
+/**
+ * @brief Columnar (struct-of-arrays) copy of the filter rules, for classifying bursts.
+ *
+ * Every Filter becomes one row holding a masked value per address, an inclusive range
+ * per port and a masked protocol, with unconstrained fields wildcarded. Rows are kept in
+ * class order, so the first matching row gives the first matching class. Classify()
+ * walks the rows once per burst and compares each block of rows against every packet
+ * still unresolved, using AVX2 or SSE4.1 kernels where the CPU supports them.
+ */
+class RuleTable {
+public:
+    enum Kernel {
+        SCALAR,
+        SSE4,
+        AVX2
+    };
+
+    static const uint32_t BURST = 256;  // packets Classify() resolves per pass over the rows
+
+    RuleTable();
+
+    void Build(const std::vector<Ptr<TrafficClass>>& classes);
+    void Clear();
+    bool IsBuilt() const;
+    bool IsComplete() const;
+    uint32_t GetRowCount() const;
+
+    void SetKernel(Kernel kernel);
+    Kernel GetKernel() const;
+    static Kernel GetBestKernel();
+
+    void Classify(std::span<const FlowKey> keys, std::span<uint32_t> out) const;
+
+private:
+    static const uint32_t LANES = 8;  // rows are padded to a multiple of the widest kernel
+
+    void AddRow(uint32_t classIndex, const std::vector<FilterElement*>& elements);
+
+    bool m_built;
+    bool m_complete;   // false if a filter holds an element the table cannot express
+    uint32_t m_rows;
+    uint32_t m_noMatch;
+    Kernel m_kernel;
+
+    std::vector<uint32_t> m_srcValue;
+    std::vector<uint32_t> m_srcMask;
+    std::vector<uint32_t> m_dstValue;
+    std::vector<uint32_t> m_dstMask;
+    std::vector<int32_t> m_srcPortLo;
+    std::vector<int32_t> m_srcPortHi;
+    std::vector<int32_t> m_dstPortLo;
+    std::vector<int32_t> m_dstPortHi;
+    std::vector<uint32_t> m_protoValue;
+    std::vector<uint32_t> m_protoMask;
+    std::vector<uint32_t> m_needs;  // FlowKey flags the row requires: valid, ports, address family
+    std::vector<uint32_t> m_class;
+};
+
+} // namespace ns3
+
+#endif /* RULE_TABLE_H */
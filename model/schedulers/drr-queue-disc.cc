@@ -0,0 +1,26 @@
+#include "drr-queue-disc.h"
+#include "drr.h"
+#include "ns3/log.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("DrrQueueDisc");
+
+NS_OBJECT_ENSURE_REGISTERED(DrrQueueDisc);
+
+TypeId DrrQueueDisc::GetTypeId(void) {
+    static TypeId tid = TypeId("ns3::DrrQueueDisc")
+        .SetParent<DiffServQueueDisc>()
+        .SetGroupName("TrafficControl")
+        .AddConstructor<DrrQueueDisc>();
+    return tid;
+}
+
+DrrQueueDisc::DrrQueueDisc() : DiffServQueueDisc(CreateObject<DRR>()) {
+}
+
+bool DrrQueueDisc::ReadConfigFile(const std::string& filename) {
+    return DynamicCast<DRR>(GetScheduler())->ReadConfigFile(filename);
+}
+
+} // namespace ns3
@@ -0,0 +1,24 @@
+#ifndef DRR_QUEUE_DISC_H
+#define DRR_QUEUE_DISC_H
+
+#include "diffserv-queue-disc.h"
+#include <string>
+
+namespace ns3 {
+
+/**
+ * @brief DRR offered as a queue disc: Deficit Round Robin scheduling of traffic classes
+ * read from a drr-config file, installable with TrafficControlHelper on any device.
+ */
+class DrrQueueDisc : public DiffServQueueDisc {
+public:
+    static TypeId GetTypeId(void);
+    DrrQueueDisc();
+
+private:
+    bool ReadConfigFile(const std::string& filename) override;
+};
+
+} // namespace ns3
+
+#endif /* DRR_QUEUE_DISC_H */
@@ -1,11 +1,14 @@
 #include "drr.h"
+#include "ns3/log.h"
 #include "ns3/string.h"
 #include "ns3/simulator.h"
-#include <fstream>
-#include <sstream>
+#include "ns3/assert.h"
+#include <algorithm>
 
 namespace ns3 {
 
+NS_LOG_COMPONENT_DEFINE("DRR");
+
 NS_OBJECT_ENSURE_REGISTERED(DRR);
 
 /**
@@ -24,7 +27,7 @@ TypeId DRR::GetTypeId(void) {
     return tid;
 }
 
-DRR::DRR() : currentQueue(0) {
+DRR::DRR() : frontCredited(false), maxPacketSize(0), quantumScale(1), scaledClasses(0) {
 }
 
 DRR::~DRR() {
@@ -33,162 +36,177 @@ DRR::~DRR() {
 /**
  * @brief Schedules a packet for dequeuing using the Deficit Round Robin algorithm.
  *
- * Iterates through the queues in a round-robin fashion, adding each queue's weight to its deficit
- * counter. Selects a packet from a queue if its deficit is sufficient to cover the packet's size.
- * Updates the deficit and logs the scheduling decision.
+ * Serves the class at the front of the active list, crediting it one quantum when its
+ * visit starts. If its deficit does not cover the head packet, the visit ends and the
+ * class moves to the back of the list, keeping its deficit. Since every quantum covers
+ * the largest packet, at most one class is skipped per call. The deficit is only charged
+ * when the packet is actually dequeued, so repeated calls return the same decision.
+ * Logs and traces the deficit updates and the scheduling decision.
  *
  * @return A pair containing the index of the scheduled queue and a pointer to the peeked packet,
  *         or {q_class.size(), nullptr} if no packet is scheduled.
  */
 std::pair<uint32_t, Ptr<const Packet>> DRR::Schedule(void) {
-    if (q_class.empty()) {
-        std::cout << "DRR::Schedule: No queues available" << std::endl;
-        return {q_class.size(), nullptr};
-    }
-
-    bool anyQueueNonEmpty = true;
-    while (anyQueueNonEmpty) {
-        anyQueueNonEmpty = false;
-        uint32_t startQueue = currentQueue;
-        std::cout << "DRR::Schedule: Starting at queue " << startQueue << std::endl;
-        do {
-            Ptr<TrafficClass> queue = q_class[currentQueue];
-            if (!queue->IsEmpty()) {
-                anyQueueNonEmpty = true;
-                Ptr<const Packet> peekedPacket = queue->Peek();
-                if (!peekedPacket) {
-                    std::cout << "DRR::Schedule: Peek returned nullptr for queue " << currentQueue << std::endl;
-                    currentQueue = (currentQueue + 1) % q_class.size();
-                    continue;
-                }
-                deficits[currentQueue] += queue->GetWeight();
-                std::cout << "DRR::Schedule: Added quantum for queue " << currentQueue 
-                          << ", new deficit=" << deficits[currentQueue] << std::endl;
-
-                if (deficits[currentQueue] < peekedPacket->GetSize()) {
-                    currentQueue = (currentQueue + 1) % q_class.size();
-                    continue;
-                }
-                deficits[currentQueue] -= peekedPacket->GetSize();
-                uint32_t scheduledQueue = currentQueue;
-
-                Ptr<TrafficClass> nextQ = q_class[scheduledQueue];
-                uint32_t nextSize = nextQ->IsEmpty() ? 0 : nextQ->Peek()->GetSize();
-                if (deficits[scheduledQueue] < nextSize) {
-                    currentQueue = (scheduledQueue + 1) % q_class.size();
-                }
-
-                std::cout << "DRR::Schedule: Scheduled packet from queue " << scheduledQueue 
-                          << ", size=" << peekedPacket->GetSize() 
-                          << ", leftover deficit=" << deficits[scheduledQueue] 
-                          << ", weight=" << queue->GetWeight() << std::endl;
-                return {scheduledQueue, peekedPacket};
-            } else {
-                deficits[currentQueue] = 0;
-                std::cout << "DRR::Schedule: Queue " << currentQueue << " is empty, deficit reset to 0" << std::endl;
-            }
-            currentQueue = (currentQueue + 1) % q_class.size();
-        } while (currentQueue != startQueue);
-
-        if (!anyQueueNonEmpty) {
-            std::cout << "DRR::Schedule: All queues empty after full round" << std::endl;
-            break;
+    while (!activeList.empty()) {
+        uint32_t index = activeList.front();
+        const PacketDescriptor* head = q_class[index]->PeekDescriptor();
+        if (!head) {
+            // Drained behind our back (e.g. by TrafficClass::Dequeue); forget the class.
+            activeList.pop_front();
+            active[index] = false;
+            deficits[index] = 0;
+            frontCredited = false;
+            continue;
         }
+        if (!frontCredited) {
+            deficits[index] += GetQuantum(index);
+            frontCredited = true;
+            NS_LOG_LOGIC("Added quantum for queue " << index << ", new deficit=" << deficits[index]);
+            tracer.Record(EventTracer::DEFICIT, index, head->size, deficits[index]);
+        }
+        if (deficits[index] >= head->size) {
+            NS_LOG_LOGIC("Scheduled packet from queue " << index
+                         << ", size=" << head->size
+                         << ", deficit=" << deficits[index]
+                         << ", weight=" << q_class[index]->GetWeight());
+            tracer.Record(EventTracer::SCHEDULE, index, head->size, deficits[index]);
+            return {index, q_class[index]->Peek()};
+        }
+        activeList.pop_front();
+        activeList.push_back(index);
+        frontCredited = false;
     }
 
-    std::cout << "DRR::Schedule: No packet scheduled (all queues empty)" << std::endl;
+    NS_LOG_LOGIC("No packet scheduled (all queues empty)");
     return {q_class.size(), nullptr};
 }
 
 /**
- * @brief Classifies a packet to determine the appropriate queue.
+ * @brief Puts a class that just became backlogged at the back of the active list.
  *
- * Iterates through the traffic class queues and returns the index of the first queue
- * whose filter matches the packet. Logs the classification result.
+ * @param index Index of the traffic class.
+ * @param size Size of the enqueued packet, in bytes.
+ */
+void DRR::NotifyEnqueued(uint32_t index, uint32_t size) {
+    if (index >= active.size()) {
+        active.resize(q_class.size(), false);
+        deficits.resize(q_class.size(), 0);
+    }
+    if (size > maxPacketSize || scaledClasses != q_class.size()) {
+        maxPacketSize = std::max(maxPacketSize, size);
+        UpdateQuantumScale();
+    }
+    if (!active[index]) {
+        active[index] = true;
+        deficits[index] = 0;
+        activeList.push_back(index);
+        NS_LOG_LOGIC("Queue " << index << " became active");
+    }
+}
+
+/**
+ * @brief Charges the dequeued packet to the front class, ending its visit if it emptied.
  *
- * @param p Pointer to the packet to be classified.
- * @return The index of the matching queue, or q_class.size() if no queue matches.
+ * @param index Index of the traffic class, the front of the active list.
+ * @param size Size of the dequeued packet, in bytes.
  */
-uint32_t DRR::Classify(Ptr<Packet> p) {
-    for (uint32_t i = 0; i < q_class.size(); ++i) {
-        if (q_class[i]->match(p)) {
-            std::cout << "DRR::Classify: Packet matched queue " << i << std::endl;
-            return i;
-        }
+void DRR::NotifyDequeued(uint32_t index, uint32_t size) {
+    NS_ASSERT(!activeList.empty() && activeList.front() == index);
+    deficits[index] -= std::min<uint64_t>(deficits[index], size);
+    if (!IsBacklogged(index)) {
+        deficits[index] = 0;
+        active[index] = false;
+        activeList.pop_front();
+        frontCredited = false;
+        NS_LOG_LOGIC("Queue " << index << " is no longer backlogged, deficit reset to 0");
     }
-    std::cout << "DRR::Classify: Packet dropped (no matching queue)" << std::endl;
-    return q_class.size();
 }
 
-bool DRR::ReadConfigFile(std::string filename) {
-    std::ifstream file(filename);
-    std::string line;
+/**
+ * @brief Arrivals never preempt: a newly backlogged class joins the back of the list.
+ */
+bool DRR::Preempts(uint32_t arrival, uint32_t pending) const {
+    return false;
+}
 
-    if (!file.is_open()) {
-        std::cerr << "Failed to open DRR config file: " << filename << std::endl;
-        return false;
-    }
+/**
+ * @brief Takes over the empty active list and deficits of a reloaded configuration; quanta
+ * are rescaled as the migrated packets arrive.
+ */
+void DRR::SwapSchedulerState(DiffServ& staged) {
+    DRR& other = static_cast<DRR&>(staged);
+    std::swap(activeList, other.activeList);
+    std::swap(active, other.active);
+    std::swap(deficits, other.deficits);
+    std::swap(frontCredited, other.frontCredited);
+    std::swap(maxPacketSize, other.maxPacketSize);
+    std::swap(quantumScale, other.quantumScale);
+    std::swap(scaledClasses, other.scaledClasses);
+}
+
+/**
+ * @brief Returns the bytes credited to a class per visit: its weight times the scale.
+ *
+ * A weight of zero counts as one, so every backlogged class is eventually served.
+ */
+uint64_t DRR::GetQuantum(uint32_t index) const {
+    return uint64_t(std::max<uint32_t>(q_class[index]->GetWeight(), 1)) * quantumScale;
+}
 
-    while (std::getline(file, line)) {
-        ParseConfigLine(line);
+/**
+ * @brief Recomputes the factor that lifts the smallest quantum to the largest packet size.
+ */
+void DRR::UpdateQuantumScale() {
+    uint32_t minWeight = UINT32_MAX;
+    for (const Ptr<TrafficClass>& tc : q_class) {
+        minWeight = std::min<uint32_t>(minWeight, std::max<uint32_t>(tc->GetWeight(), 1));
     }
-    file.close();
+    scaledClasses = q_class.size();
+    quantumScale = std::max<uint32_t>(1, (maxPacketSize + minWeight - 1) / minWeight);
+    NS_LOG_INFO("Quantum scale=" << quantumScale << " (largest packet=" << maxPacketSize
+                << ", smallest weight=" << minWeight << ")");
+}
 
-    deficits.resize(q_class.size(), 0);
-    std::cout << "DRR::ReadConfigFile: Configured " << q_class.size() << " queues" << std::endl;
-    return true;
+/**
+ * @brief Classifies a packet to determine the appropriate queue.
+ *
+ * Looks the packet's flow key up in the compiled classifier, which returns the index of
+ * the first queue whose filter matches, as an in-order scan of the queues would. Logs the
+ * classification result.
+ *
+ * @param key Header fields extracted from the packet to be classified.
+ * @return The index of the matching queue, or q_class.size() if no queue matches.
+ */
+uint32_t DRR::Classify(const FlowKey& key) {
+    uint32_t index = LookupClass(key);
+    if (index < q_class.size()) {
+        NS_LOG_LOGIC("Packet matched queue " << index);
+    } else {
+        NS_LOG_DEBUG("Packet dropped (no matching queue)");
+    }
+    return index;
 }
 
 /**
- * @brief Parses a single line from the configuration file.
+ * @brief Applies one line of the configuration file.
  *
- * Interprets the line to configure a queue (with weight and max packets) or a filter
- * (e.g., source/destination IP, port, or protocol) for a specific queue. Logs the parsing result.
+ * Declares a queue; queues share the link in proportion to their weights:
  *
- * @param line The configuration line to parse.
+ *     queue <id> <weight> <maxPackets>
+ *
+ * Weights are relative: each visit credits a queue its weight times a scale that makes
+ * the smallest quantum cover the largest packet, so only their ratios matter.
+ *
+ * Any other line is handed to DiffServ::ParseConfigLine().
+ *
+ * @param line The line, split into words.
+ * @return True if the line was applied; otherwise the error is recorded on line.
  */
-void DRR::ParseConfigLine(const std::string& line) {
-    std::istringstream iss(line);
-    std::string token;
-    iss >> token;
-
-    if (token == "queue") {
-        uint32_t queueId, quantum, maxPackets;
-        if (iss >> queueId >> quantum >> maxPackets) {
-            Ptr<TrafficClass> tc = CreateObject<TrafficClass>();
-            tc->SetWeight(quantum);
-            tc->SetMaxPackets(maxPackets);
-            AddQueue(tc);
-            std::cout << "DRR::ParseConfigLine: Added queue " << queueId << ", quantum=" << quantum 
-                      << ", maxPackets=" << maxPackets << std::endl;
-        }
-    } else if (token == "filter") {
-        uint32_t queueId;
-        std::string filterType, value;
-        if (iss >> queueId >> filterType >> value) {
-            Filter* filter = new Filter();
-            if (filterType == "src_ip") {
-                filter->AddElement(new SrcIPAddress(Ipv4Address(value.c_str())));
-            } else if (filterType == "dst_ip") {
-                filter->AddElement(new DstIPAddress(Ipv4Address(value.c_str())));
-            } else if (filterType == "src_port") {
-                filter->AddElement(new SrcPortNumber(std::stoi(value)));
-            } else if (filterType == "dst_port") {
-                filter->AddElement(new DstPortNumber(std::stoi(value)));
-                std::cout << "DRR::ParseConfigLine: Added filter for dst_port=" << value << " to queue " << queueId << std::endl;
-            } else if (filterType == "protocol") {
-                filter->AddElement(new ProtocolNumber(std::stoi(value)));
-            }
-            if (queueId < q_class.size()) {
-                q_class[queueId]->AddFilter(filter);
-                std::cout << "DRR::ParseConfigLine: Added filter to queue " << queueId 
-                          << ", type=" << filterType << ", value=" << value << std::endl;
-            } else {
-                std::cerr << "DRR::ParseConfigLine: Invalid queueId " << queueId << " for filter" << std::endl;
-                delete filter;
-            }
-        }
+bool DRR::ParseConfigLine(ConfigParser& line) {
+    if (line.GetWord(0) != "queue") {
+        return DiffServ::ParseConfigLine(line);
     }
+    return ParseQueueLine(line, &TrafficClass::SetWeight);
 }
 
 } // namespace ns3
@@ -4,11 +4,20 @@
 #include "diffserv.h"
 #include "traffic-class.h"
 #include "ns3/ptr.h"
+#include <deque>
 #include <vector>
 #include <utility>
 
 namespace ns3 {
 
+/**
+ * @brief Deficit Round Robin (Shreedhar and Varghese), with a list of backlogged classes.
+ *
+ * Only classes holding packets are on the active list, and the class at its front is
+ * credited one quantum per visit. Quanta are the configured weights scaled by a common
+ * factor, so that the smallest is at least the largest packet seen: every visit then
+ * sends at least one packet and Schedule() is O(1), while the weights keep their ratios.
+ */
 class DRR : public DiffServ {
 public:
     static TypeId GetTypeId(void);
@@ -16,13 +25,26 @@ public:
     virtual ~DRR();
 
     virtual std::pair<uint32_t, Ptr<const Packet>> Schedule(void);
-    virtual uint32_t Classify(Ptr<Packet> p);
-    bool ReadConfigFile(std::string filename);
-    virtual void ParseConfigLine(const std::string& line);
+    virtual uint32_t Classify(const FlowKey& key);
+
+protected:
+    bool ParseConfigLine(ConfigParser& line) override;
+    void NotifyEnqueued(uint32_t index, uint32_t size) override;
+    void NotifyDequeued(uint32_t index, uint32_t size) override;
+    bool Preempts(uint32_t arrival, uint32_t pending) const override;
+    void SwapSchedulerState(DiffServ& staged) override;
 
 private:
-    uint32_t currentQueue;
-    std::vector<double> deficits;
+    uint64_t GetQuantum(uint32_t index) const;
+    void UpdateQuantumScale();
+
+    std::deque<uint32_t> activeList;   // backlogged classes, in service order
+    std::vector<uint8_t> active;       // whether each class is on activeList
+    std::vector<uint64_t> deficits;    // bytes; weight * quantumScale can exceed 32 bits
+    bool frontCredited;                // front class already got its quantum for this visit
+    uint32_t maxPacketSize;
+    uint32_t quantumScale;
+    uint32_t scaledClasses;            // number of classes when quantumScale was computed
 };
 
 } // namespace ns3
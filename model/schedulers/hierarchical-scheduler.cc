@@ -0,0 +1,551 @@
+#include "hierarchical-scheduler.h"
+#include "ns3/log.h"
+#include "ns3/string.h"
+#include "ns3/simulator.h"
+#include "ns3/abort.h"
+#include "ns3/assert.h"
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("HierarchicalScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED(HierarchicalScheduler);
+
+/**
+ * @brief Returns the TypeId for HierarchicalScheduler.
+ *
+ * Registers the HierarchicalScheduler class with the ns-3 object system, setting it as a
+ * child of DiffServ and assigning it to the "Network" group.
+ *
+ * @return The TypeId of the HierarchicalScheduler class.
+ */
+TypeId HierarchicalScheduler::GetTypeId(void) {
+    static TypeId tid = TypeId("ns3::HierarchicalScheduler")
+        .SetParent<DiffServ>()
+        .SetGroupName("Network")
+        .AddConstructor<HierarchicalScheduler>();
+    return tid;
+}
+
+HierarchicalScheduler::HierarchicalScheduler()
+    : root(NO_PARENT), maxPacketSize(0), lastArrivalActivated(false) {
+}
+
+HierarchicalScheduler::~HierarchicalScheduler() {
+}
+
+/**
+ * @brief Adds an interior node to the tree.
+ *
+ * @param policy How the node shares its bandwidth among its children.
+ * @param parent Index of the parent node, or NO_PARENT for the root.
+ * @param weight The node's weight under a DRR or WFQ parent.
+ * @param priority The node's priority under an SPQ parent; higher values are served first.
+ * @return The index of the new node.
+ */
+uint32_t HierarchicalScheduler::AddNode(Policy policy, uint32_t parent, uint32_t weight, uint32_t priority) {
+    NS_ABORT_MSG_IF(parent == NO_PARENT && root != NO_PARENT, "The scheduling tree already has a root");
+    NS_ABORT_MSG_IF(parent != NO_PARENT && parent >= nodes.size(), "Unknown parent node " << parent);
+
+    uint32_t index = nodes.size();
+    nodes.emplace_back();
+    Node& node = nodes.back();
+    node.policy = policy;
+    node.parent = parent;
+    node.slot = 0;
+    node.weight = weight;
+    node.priority = priority;
+    node.prepared = false;
+    node.backlogged = 0;
+    node.selected = -1;
+    node.levelSummary = 0;
+    node.frontCredited = false;
+    node.minWeight = 1;
+    node.quantumScale = 1;
+    node.scaledFor = 0;
+    node.virtualTime = 0;
+    node.totalWeight = 0;
+
+    if (parent == NO_PARENT) {
+        root = index;
+    } else {
+        AddChild(parent, index);
+    }
+    NS_LOG_INFO("Added node " << index << ", parent=" << parent << ", policy=" << policy
+                << ", weight=" << weight << ", priority=" << priority);
+    return index;
+}
+
+/**
+ * @brief Adds a traffic class as a leaf under the given node.
+ *
+ * @param trafficClass The traffic class to add; it also becomes the next queue index.
+ * @param parent Index of the node the leaf hangs off.
+ */
+void HierarchicalScheduler::AttachQueue(Ptr<TrafficClass> trafficClass, uint32_t parent) {
+    NS_ABORT_MSG_IF(parent >= nodes.size(), "Unknown parent node " << parent);
+    AddQueue(trafficClass);
+    uint32_t index = q_class.size() - 1;
+    leafParent.resize(q_class.size(), NO_PARENT);
+    leafSlot.resize(q_class.size(), 0);
+    leafActive.resize(q_class.size(), false);
+    leafParent[index] = parent;
+    leafSlot[index] = nodes[parent].children.size();
+    AddChild(parent, LEAF | index);
+}
+
+uint32_t HierarchicalScheduler::GetNodeCount() const {
+    return nodes.size();
+}
+
+void HierarchicalScheduler::AddChild(uint32_t parent, uint32_t child) {
+    Node& node = nodes[parent];
+    if (!(child & LEAF)) {
+        nodes[child].slot = node.children.size();
+    }
+    node.children.push_back(child);
+    node.prepared = false;
+}
+
+/**
+ * @brief Hangs a queue added with plain AddQueue() off the root, creating a DRR root if needed.
+ */
+void HierarchicalScheduler::AttachLeaf(uint32_t index) {
+    if (root == NO_PARENT) {
+        AddNode(DEFICIT_ROUND_ROBIN, NO_PARENT);
+    }
+    leafParent.resize(q_class.size(), NO_PARENT);
+    leafSlot.resize(q_class.size(), 0);
+    leafActive.resize(q_class.size(), false);
+    leafParent[index] = root;
+    leafSlot[index] = nodes[root].children.size();
+    AddChild(root, LEAF | index);
+    NS_LOG_LOGIC("Queue " << index << " attached to the root");
+}
+
+/**
+ * @brief Brings a node's per-child state in line with its children.
+ *
+ * Runs on first use and after children are added. Children already backlogged keep their
+ * place in service order.
+ */
+void HierarchicalScheduler::Prepare(Node& node) {
+    if (node.prepared) {
+        return;
+    }
+    uint32_t count = node.children.size();
+    std::vector<uint32_t> priorities(count);
+    node.childWeight.resize(count);
+    node.minWeight = UINT32_MAX;
+    node.totalWeight = 0;
+    for (uint32_t slot = 0; slot < count; ++slot) {
+        uint32_t child = node.children[slot];
+        uint32_t weight = (child & LEAF) ? q_class[child & ~LEAF]->GetWeight() : nodes[child].weight;
+        priorities[slot] = (child & LEAF) ? q_class[child & ~LEAF]->GetPriorityLevel() : nodes[child].priority;
+        node.childWeight[slot] = std::max<uint32_t>(weight, 1);
+        node.minWeight = std::min(node.minWeight, node.childWeight[slot]);
+        node.totalWeight += node.childWeight[slot];
+    }
+    node.deficit.resize(count, 0);
+    node.start.resize(count, 0);
+    node.finish.resize(count, 0);
+    node.scaledFor = 0;
+
+    if (node.policy == STRICT_PRIORITY) {
+        std::vector<uint32_t> ranked = priorities;
+        std::sort(ranked.begin(), ranked.end());
+        ranked.erase(std::unique(ranked.begin(), ranked.end()), ranked.end());
+
+        std::vector<uint32_t> backlogged;
+        for (uint32_t level = node.levels.size(); level-- > 0;) {
+            backlogged.insert(backlogged.end(), node.levels[level].begin(), node.levels[level].end());
+        }
+        node.level.resize(count);
+        for (uint32_t slot = 0; slot < count; ++slot) {
+            node.level[slot] = std::lower_bound(ranked.begin(), ranked.end(), priorities[slot]) - ranked.begin();
+        }
+        node.levels.assign(ranked.size(), std::deque<uint32_t>());
+        node.levelWords.assign((ranked.size() + 63) / 64, 0);
+        node.levelSummary = 0;
+        node.prepared = true;
+        for (uint32_t slot : backlogged) {
+            Activate(node, slot, 0);
+        }
+    }
+    node.prepared = true;
+    node.selected = -1;
+}
+
+/**
+ * @brief Schedules a packet by following each node's choice from the root to a leaf.
+ *
+ * Every node on the way caches the child it picked until a packet arrives in or leaves
+ * its subtree, so repeated calls return the same decision. Logs and traces the decision.
+ *
+ * @return A pair containing the index of the scheduled queue and a pointer to the peeked packet,
+ *         or {q_class.size(), nullptr} if no packet is scheduled.
+ */
+std::pair<uint32_t, Ptr<const Packet>> HierarchicalScheduler::Schedule(void) {
+    if (root == NO_PARENT || nodes[root].backlogged == 0) {
+        NS_LOG_LOGIC("No packet scheduled (all queues empty)");
+        return {q_class.size(), nullptr};
+    }
+    uint32_t index = SelectLeaf(root);
+    const PacketDescriptor* head = q_class[index]->PeekDescriptor();
+    NS_ASSERT_MSG(head, "Queue " << index << " was drained outside the scheduler");
+    NS_LOG_LOGIC("Scheduled packet from queue " << index << ", size=" << head->size);
+    tracer.Record(EventTracer::SCHEDULE, index, head->size);
+    return {index, q_class[index]->Peek()};
+}
+
+/**
+ * @brief Follows the cached choices from a backlogged node down to a leaf.
+ *
+ * @param index Index of the node to start from.
+ * @return The index of the queue the node would serve next.
+ */
+uint32_t HierarchicalScheduler::SelectLeaf(uint32_t index) {
+    while (true) {
+        Node& node = nodes[index];
+        uint32_t child = node.children[Select(node)];
+        if (child & LEAF) {
+            return child & ~LEAF;
+        }
+        index = child;
+    }
+}
+
+/**
+ * @brief Returns the size of the packet a backlogged child would send next.
+ */
+uint32_t HierarchicalScheduler::HeadSize(uint32_t child) {
+    uint32_t index = (child & LEAF) ? child & ~LEAF : SelectLeaf(child);
+    return q_class[index]->PeekDescriptor()->size;
+}
+
+/**
+ * @brief Picks the backlogged child a node serves next, reusing the cached choice if valid.
+ *
+ * SPQ takes the front child of the highest backlogged priority, DRR the front of its
+ * active list once its deficit covers the child's head packet, and WF2Q+ the eligible
+ * child with the smallest virtual finish time.
+ *
+ * @param node A node with at least one backlogged child.
+ * @return The slot of the chosen child.
+ */
+uint32_t HierarchicalScheduler::Select(Node& node) {
+    if (node.selected >= 0) {
+        return node.selected;
+    }
+    NS_ASSERT(node.backlogged > 0);
+    uint32_t slot = 0;
+    switch (node.policy) {
+    case STRICT_PRIORITY: {
+        uint32_t word = 63 - __builtin_clzll(node.levelSummary);
+        uint32_t level = word * 64 + 63 - __builtin_clzll(node.levelWords[word]);
+        slot = node.levels[level].front();
+        break;
+    }
+    case DEFICIT_ROUND_ROBIN:
+        if (node.scaledFor != maxPacketSize) {
+            node.scaledFor = maxPacketSize;
+            node.quantumScale = std::max<uint32_t>(1, (maxPacketSize + node.minWeight - 1) / node.minWeight);
+        }
+        while (true) {
+            slot = node.activeList.front();
+            if (!node.frontCredited) {
+                node.deficit[slot] += uint64_t(node.childWeight[slot]) * node.quantumScale;
+                node.frontCredited = true;
+            }
+            if (node.deficit[slot] >= HeadSize(node.children[slot])) {
+                break;
+            }
+            node.activeList.pop_front();
+            node.activeList.push_back(slot);
+            node.frontCredited = false;
+        }
+        break;
+    case FAIR_QUEUEING:
+        if (node.eligible.empty()) {
+            node.virtualTime = std::max(node.virtualTime, node.waiting.top().first);
+        }
+        while (!node.waiting.empty() && node.waiting.top().first <= node.virtualTime) {
+            uint32_t waiting = node.waiting.top().second;
+            node.waiting.pop();
+            node.eligible.push({node.finish[waiting], waiting});
+        }
+        slot = node.eligible.top().second;
+        break;
+    }
+    node.selected = slot;
+    return slot;
+}
+
+/**
+ * @brief Adds a child that just became backlogged to its parent's service order.
+ *
+ * @param node The parent node.
+ * @param slot The child's slot in the parent.
+ * @param headSize Size of the child's head packet, in bytes.
+ */
+void HierarchicalScheduler::Activate(Node& node, uint32_t slot, uint32_t headSize) {
+    switch (node.policy) {
+    case STRICT_PRIORITY: {
+        uint32_t level = node.level[slot];
+        node.levels[level].push_back(slot);
+        node.levelWords[level / 64] |= 1ULL << (level % 64);
+        node.levelSummary |= 1ULL << (level / 64);
+        break;
+    }
+    case DEFICIT_ROUND_ROBIN:
+        node.deficit[slot] = 0;
+        node.activeList.push_back(slot);
+        break;
+    case FAIR_QUEUEING:
+        node.start[slot] = std::max(node.finish[slot], node.virtualTime);
+        node.finish[slot] = node.start[slot] + Span(headSize, node.childWeight[slot]);
+        node.waiting.push({node.start[slot], slot});
+        break;
+    }
+}
+
+/**
+ * @brief Returns the virtual time a child of the given weight needs to send the given bytes.
+ */
+uint64_t HierarchicalScheduler::Span(uint32_t bytes, uint64_t weight) const {
+    return static_cast<uint64_t>(bytes) * VIRTUAL_TIME_SCALE / weight;
+}
+
+/**
+ * @brief Charges a packet sent by the child a node had selected and ends its turn if needed.
+ *
+ * @param node The parent node.
+ * @param slot The slot of the selected child.
+ * @param bytes Size of the packet sent, in bytes.
+ * @param backlogged Whether the child still has packets.
+ * @param nextHeadSize Size of the child's next packet, if it is still backlogged.
+ */
+void HierarchicalScheduler::Charge(Node& node, uint32_t slot, uint32_t bytes, bool backlogged,
+                                   uint32_t nextHeadSize) {
+    NS_ASSERT(node.selected == static_cast<int32_t>(slot));
+    switch (node.policy) {
+    case STRICT_PRIORITY: {
+        uint32_t level = node.level[slot];
+        node.levels[level].pop_front();
+        if (backlogged) {
+            node.levels[level].push_back(slot);
+        } else if (node.levels[level].empty()) {
+            node.levelWords[level / 64] &= ~(1ULL << (level % 64));
+            if (node.levelWords[level / 64] == 0) {
+                node.levelSummary &= ~(1ULL << (level / 64));
+            }
+        }
+        break;
+    }
+    case DEFICIT_ROUND_ROBIN:
+        node.deficit[slot] -= std::min<uint64_t>(node.deficit[slot], bytes);
+        if (!backlogged) {
+            node.deficit[slot] = 0;
+            node.activeList.pop_front();
+            node.frontCredited = false;
+        }
+        break;
+    case FAIR_QUEUEING:
+        node.eligible.pop();
+        node.virtualTime += Span(bytes, node.totalWeight);
+        if (backlogged) {
+            node.start[slot] = node.finish[slot];
+            node.finish[slot] = node.start[slot] + Span(nextHeadSize, node.childWeight[slot]);
+            node.waiting.push({node.start[slot], slot});
+        }
+        break;
+    }
+    if (!backlogged) {
+        node.backlogged--;
+    }
+    node.selected = -1;
+}
+
+/**
+ * @brief Activates the path from a newly backlogged leaf up to the first backlogged ancestor.
+ *
+ * The leaf's packet is the only one in every subtree activated on the way, so it is the
+ * head packet each of them is stamped with. Cached choices are dropped up to the root.
+ *
+ * @param index Index of the traffic class.
+ * @param size Size of the enqueued packet, in bytes.
+ */
+void HierarchicalScheduler::NotifyEnqueued(uint32_t index, uint32_t size) {
+    if (index >= leafParent.size() || leafParent[index] == NO_PARENT) {
+        AttachLeaf(index);
+    }
+    maxPacketSize = std::max(maxPacketSize, size);
+    lastArrivalActivated = !leafActive[index];
+    if (!lastArrivalActivated) {
+        return;
+    }
+    leafActive[index] = true;
+
+    uint32_t current = leafParent[index];
+    uint32_t slot = leafSlot[index];
+    bool activating = true;
+    while (current != NO_PARENT) {
+        Node& node = nodes[current];
+        if (activating) {
+            Prepare(node);
+            Activate(node, slot, size);
+            activating = node.backlogged++ == 0;
+        }
+        node.selected = -1;
+        slot = node.slot;
+        current = node.parent;
+    }
+    NS_LOG_LOGIC("Queue " << index << " became active");
+}
+
+/**
+ * @brief Charges the dequeued packet to every node on the path from its leaf to the root.
+ *
+ * Works bottom-up, so each child's next head packet is known by the time its parent is
+ * charged.
+ *
+ * @param index Index of the traffic class that was served.
+ * @param size Size of the dequeued packet, in bytes.
+ */
+void HierarchicalScheduler::NotifyDequeued(uint32_t index, uint32_t size) {
+    bool backlogged = IsBacklogged(index);
+    leafActive[index] = backlogged;
+
+    uint32_t child = LEAF | index;
+    uint32_t current = leafParent[index];
+    uint32_t slot = leafSlot[index];
+    while (current != NO_PARENT) {
+        Node& node = nodes[current];
+        Charge(node, slot, size, backlogged, backlogged ? HeadSize(child) : 0);
+        backlogged = node.backlogged > 0;
+        child = current;
+        slot = node.slot;
+        current = node.parent;
+    }
+}
+
+/**
+ * @brief Recomputes the decision whenever an arrival changed the set of backlogged children.
+ *
+ * An arrival to a class that was already backlogged changes no node's choice.
+ */
+bool HierarchicalScheduler::Preempts(uint32_t arrival, uint32_t pending) const {
+    return lastArrivalActivated;
+}
+
+/**
+ * @brief Takes over the node tree of a reloaded configuration, with no child backlogged.
+ */
+void HierarchicalScheduler::SwapSchedulerState(DiffServ& staged) {
+    HierarchicalScheduler& other = static_cast<HierarchicalScheduler&>(staged);
+    std::swap(nodes, other.nodes);
+    std::swap(root, other.root);
+    std::swap(leafParent, other.leafParent);
+    std::swap(leafSlot, other.leafSlot);
+    std::swap(leafActive, other.leafActive);
+    std::swap(maxPacketSize, other.maxPacketSize);
+    std::swap(lastArrivalActivated, other.lastArrivalActivated);
+    std::swap(configNodes, other.configNodes);
+}
+
+/**
+ * @brief Classifies a packet to determine the appropriate leaf queue.
+ *
+ * Looks the packet's flow key up in the compiled classifier, which returns the index of
+ * the first queue whose filter matches, as an in-order scan of the queues would. Logs the
+ * classification result.
+ *
+ * @param key Header fields extracted from the packet to be classified.
+ * @return The index of the matching queue, or q_class.size() if no queue matches.
+ */
+uint32_t HierarchicalScheduler::Classify(const FlowKey& key) {
+    uint32_t index = LookupClass(key);
+    if (index < q_class.size()) {
+        NS_LOG_LOGIC("Packet matched queue " << index);
+    } else {
+        NS_LOG_DEBUG("Packet dropped (no matching queue)");
+    }
+    return index;
+}
+
+/**
+ * @brief Applies one line of the configuration file.
+ *
+ * Declares an interior node or a leaf queue:
+ *
+ *     node <id> <parentId|-> <spq|drr|wfq> <weight> <priority>
+ *     queue <id> <parentId> <weight> <priority> <maxPackets>
+ *
+ * and hands the other lines, filters included, to DiffServ::ParseConfigLine(). Parents
+ * must be declared before their children; the node whose parent is "-" is the root.
+ * Queue ids follow declaration order, as for the flat schedulers.
+ *
+ * @param line The line, split into words.
+ * @return True if the line was applied; otherwise the error is recorded on line.
+ */
+bool HierarchicalScheduler::ParseConfigLine(ConfigParser& line) {
+    std::string_view keyword = line.GetWord(0);
+    if (keyword == "node") {
+        uint32_t nodeId, parentId, weight, priority;
+        if (!line.ExpectWords(6, 6) || !line.GetUint32(1, nodeId) || !line.GetUint32(4, weight)
+            || !line.GetUint32(5, priority)) {
+            return false;
+        }
+        Policy policy;
+        std::string_view policyName = line.GetWord(3);
+        if (policyName == "spq") {
+            policy = STRICT_PRIORITY;
+        } else if (policyName == "drr") {
+            policy = DEFICIT_ROUND_ROBIN;
+        } else if (policyName == "wfq") {
+            policy = FAIR_QUEUEING;
+        } else {
+            return line.Error("unknown policy '" + std::string(policyName) + "'");
+        }
+        if (configNodes.count(nodeId)) {
+            return line.Error("node " + std::to_string(nodeId) + " is already declared");
+        }
+        uint32_t parent = NO_PARENT;
+        if (line.GetWord(2) != "-") {
+            if (!line.GetUint32(2, parentId)) {
+                return false;
+            }
+            auto it = configNodes.find(parentId);
+            if (it == configNodes.end()) {
+                return line.Error("parent node " + std::to_string(parentId) + " is not declared");
+            }
+            parent = it->second;
+        } else if (root != NO_PARENT) {
+            return line.Error("the tree already has a root");
+        }
+        configNodes[nodeId] = AddNode(policy, parent, weight, priority);
+        return true;
+    }
+    if (keyword == "queue") {
+        uint32_t queueId, parentId, weight, priority, maxPackets;
+        if (!line.ExpectWords(6, 6) || !line.GetUint32(1, queueId) || !line.GetUint32(2, parentId)
+            || !line.GetUint32(3, weight) || !line.GetUint32(4, priority) || !line.GetUint32(5, maxPackets)
+            || !CheckNewQueueId(line, queueId)) {
+            return false;
+        }
+        auto it = configNodes.find(parentId);
+        if (it == configNodes.end()) {
+            return line.Error("parent node " + std::to_string(parentId) + " is not declared");
+        }
+        Ptr<TrafficClass> tc = CreateObject<TrafficClass>();
+        tc->SetWeight(weight);
+        tc->SetPriorityLevel(priority);
+        tc->SetMaxPackets(maxPackets);
+        AttachQueue(tc, it->second);
+        return true;
+    }
+    return DiffServ::ParseConfigLine(line);
+}
+
+} // namespace ns3
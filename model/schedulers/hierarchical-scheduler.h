@@ -0,0 +1,116 @@
+#ifndef HIERARCHICAL_SCHEDULER_H
+#define HIERARCHICAL_SCHEDULER_H
+
+#include "diffserv.h"
+#include "traffic-class.h"
+#include "ns3/ptr.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <queue>
+#include <vector>
+#include <utility>
+
+namespace ns3 {
+
+/**
+ * @brief Scheduling tree whose interior nodes are SPQ, DRR or WFQ policies and whose
+ * leaves are the TrafficClass queues.
+ *
+ * Classification maps a packet straight to a leaf. Each node only tracks its backlogged
+ * children and caches the child it would serve next, so an enqueue activates at most
+ * the path from its leaf to the first already-backlogged ancestor, and a dequeue follows
+ * and then charges the single root-to-leaf path: both cost O(depth), independent of the
+ * number of leaves. Children weigh in with their weight (DRR, WFQ) or priority (SPQ):
+ * TrafficClass::GetWeight()/GetPriorityLevel() for leaves, the values given to AddNode()
+ * for interior nodes.
+ */
+class HierarchicalScheduler : public DiffServ {
+public:
+    enum Policy {
+        STRICT_PRIORITY,
+        DEFICIT_ROUND_ROBIN,
+        FAIR_QUEUEING
+    };
+
+    static constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+    static TypeId GetTypeId(void);
+    HierarchicalScheduler();
+    virtual ~HierarchicalScheduler();
+
+    uint32_t AddNode(Policy policy, uint32_t parent, uint32_t weight = 1, uint32_t priority = 0);
+    void AttachQueue(Ptr<TrafficClass> trafficClass, uint32_t parent);
+    uint32_t GetNodeCount() const;
+
+    virtual std::pair<uint32_t, Ptr<const Packet>> Schedule(void);
+    virtual uint32_t Classify(const FlowKey& key);
+
+protected:
+    bool ParseConfigLine(ConfigParser& line) override;
+    void NotifyEnqueued(uint32_t index, uint32_t size) override;
+    void NotifyDequeued(uint32_t index, uint32_t size) override;
+    bool Preempts(uint32_t arrival, uint32_t pending) const override;
+    void SwapSchedulerState(DiffServ& staged) override;
+
+private:
+    typedef std::pair<uint64_t, uint32_t> HeapEntry;  // (virtual time, child slot)
+    typedef std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> MinHeap;
+
+    static const uint32_t LEAF = 0x80000000;            // child encoding: LEAF | queue index, or node index
+    static const uint64_t VIRTUAL_TIME_SCALE = 1 << 16;  // virtual time units per byte at full weight
+
+    struct Node {
+        Policy policy;
+        uint32_t parent;
+        uint32_t slot;                     // position among the parent's children
+        uint32_t weight;
+        uint32_t priority;
+        std::vector<uint32_t> children;
+        bool prepared;                     // per-child state matches children
+        uint32_t backlogged;               // number of backlogged children
+        int32_t selected;                  // cached Select() result, -1 if stale
+
+        std::vector<uint32_t> childWeight;
+        std::vector<uint32_t> level;       // SPQ: rank of each child's priority
+        std::vector<std::deque<uint32_t>> levels;
+        std::vector<uint64_t> levelWords;
+        uint64_t levelSummary;
+        std::deque<uint32_t> activeList;   // DRR
+        std::vector<uint64_t> deficit;     // bytes; weight * quantumScale can exceed 32 bits
+        bool frontCredited;
+        uint32_t minWeight;
+        uint32_t quantumScale;
+        uint32_t scaledFor;                // largest packet size quantumScale was computed for
+        uint64_t virtualTime;              // WFQ
+        uint64_t totalWeight;
+        std::vector<uint64_t> start;
+        std::vector<uint64_t> finish;
+        MinHeap eligible;
+        MinHeap waiting;
+    };
+
+    void AddChild(uint32_t parent, uint32_t child);
+    void AttachLeaf(uint32_t index);
+    void Prepare(Node& node);
+    uint32_t SelectLeaf(uint32_t node);
+    uint32_t Select(Node& node);
+    uint32_t HeadSize(uint32_t child);
+    void Activate(Node& node, uint32_t slot, uint32_t headSize);
+    void Charge(Node& node, uint32_t slot, uint32_t bytes, bool backlogged, uint32_t nextHeadSize);
+    uint64_t Span(uint32_t bytes, uint64_t weight) const;
+
+    std::vector<Node> nodes;
+    uint32_t root;
+    std::vector<uint32_t> leafParent;
+    std::vector<uint32_t> leafSlot;
+    std::vector<uint8_t> leafActive;
+    uint32_t maxPacketSize;
+    bool lastArrivalActivated;
+    std::map<uint32_t, uint32_t> configNodes;  // node id in the config file -> node index
+};
+
+} // namespace ns3
+
+#endif // HIERARCHICAL_SCHEDULER_H
@@ -0,0 +1,26 @@
+#include "spq-queue-disc.h"
+#include "spq.h"
+#include "ns3/log.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("SpqQueueDisc");
+
+NS_OBJECT_ENSURE_REGISTERED(SpqQueueDisc);
+
+TypeId SpqQueueDisc::GetTypeId(void) {
+    static TypeId tid = TypeId("ns3::SpqQueueDisc")
+        .SetParent<DiffServQueueDisc>()
+        .SetGroupName("TrafficControl")
+        .AddConstructor<SpqQueueDisc>();
+    return tid;
+}
+
+SpqQueueDisc::SpqQueueDisc() : DiffServQueueDisc(CreateObject<SPQ>()) {
+}
+
+bool SpqQueueDisc::ReadConfigFile(const std::string& filename) {
+    return DynamicCast<SPQ>(GetScheduler())->ReadConfigFile(filename);
+}
+
+} // namespace ns3
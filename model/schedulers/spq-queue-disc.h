@@ -0,0 +1,24 @@
+#ifndef SPQ_QUEUE_DISC_H
+#define SPQ_QUEUE_DISC_H
+
+#include "diffserv-queue-disc.h"
+#include <string>
+
+namespace ns3 {
+
+/**
+ * @brief SPQ offered as a queue disc: strict priority scheduling of traffic classes
+ * read from a spq-config file, installable with TrafficControlHelper on any device.
+ */
+class SpqQueueDisc : public DiffServQueueDisc {
+public:
+    static TypeId GetTypeId(void);
+    SpqQueueDisc();
+
+private:
+    bool ReadConfigFile(const std::string& filename) override;
+};
+
+} // namespace ns3
+
+#endif /* SPQ_QUEUE_DISC_H */
@@ -1,11 +1,15 @@
 #include "spq.h"
+#include "ns3/log.h"
 #include "ns3/string.h"
 #include "ns3/simulator.h"
-#include <fstream>
-#include <sstream>
+#include "ns3/abort.h"
+#include "ns3/assert.h"
+#include <algorithm>
 
 namespace ns3 {
 
+NS_LOG_COMPONENT_DEFINE("SPQ");
+
 NS_OBJECT_ENSURE_REGISTERED(SPQ);
 
 /**
@@ -24,7 +28,7 @@ TypeId SPQ::GetTypeId(void) {
     return tid;
 }
 
-SPQ::SPQ() {
+SPQ::SPQ() : levelSummary(0), rankedClasses(0) {
 }
 
 SPQ::~SPQ() {
@@ -33,128 +37,187 @@ SPQ::~SPQ() {
 /**
  * @brief Schedules a packet for dequeuing using the Strict Priority Queue algorithm.
  *
- * Selects the non-empty queue with the highest priority level and returns its peeked packet.
- * Logs the scheduling decision, including queue index, priority, packet size, and simulation time.
+ * Finds the highest backlogged priority in the level bitmap and returns the head packet
+ * of the class at the front of that level's FIFO. Logs and traces the scheduling
+ * decision, including queue index, priority, packet size, and simulation time.
  *
  * @return A pair containing the index of the scheduled queue and a pointer to the peeked packet,
  *         or {q_class.size(), nullptr} if no packet is scheduled.
  */
 std::pair<uint32_t, Ptr<const Packet>> SPQ::Schedule(void) {
-    int selectedQueue = -1;
-    int maxPriority = -1;
-
-    for (uint32_t i = 0; i < q_class.size(); ++i) {
-        int priority = q_class[i]->GetPriorityLevel();
-        if (!q_class[i]->IsEmpty() && priority > maxPriority) {
-            maxPriority = priority;
-            selectedQueue = i;
+    while (levelSummary != 0) {
+        uint32_t word = 63 - __builtin_clzll(levelSummary);
+        uint32_t level = word * 64 + 63 - __builtin_clzll(levelWords[word]);
+        uint32_t index = levels[level].front();
+        const PacketDescriptor* head = q_class[index]->PeekDescriptor();
+        if (!head) {
+            // Drained behind our back (e.g. by TrafficClass::Dequeue); forget the class.
+            active[index] = false;
+            levels[level].pop_front();
+            Deactivate(level);
+            continue;
         }
+        NS_LOG_LOGIC("Scheduled packet from queue " << index
+                     << ", priority=" << q_class[index]->GetPriorityLevel() << ", size=" << head->size
+                     << ", time=" << Simulator::Now().GetSeconds() << "s");
+        tracer.Record(EventTracer::SCHEDULE, index, head->size);
+        return {index, q_class[index]->Peek()};
     }
 
-    if (selectedQueue >= 0) {
-        Ptr<const Packet> peekedPacket = q_class[selectedQueue]->Peek();
-        if (peekedPacket) {
-            std::cout << "SPQ::Schedule: Scheduled packet from queue " << selectedQueue 
-                      << ", priority=" << maxPriority << ", size=" << peekedPacket->GetSize() 
-                      << ", time=" << Simulator::Now().GetSeconds() << "s" << std::endl;
-            return {static_cast<uint32_t>(selectedQueue), peekedPacket};
-        }
+    NS_LOG_LOGIC("No packet scheduled (all queues empty)");
+    return {q_class.size(), nullptr};
+}
+
+/**
+ * @brief Marks a class that just became backlogged in its priority level.
+ *
+ * @param index Index of the traffic class.
+ * @param size Size of the enqueued packet, in bytes.
+ */
+void SPQ::NotifyEnqueued(uint32_t index, uint32_t size) {
+    if (rankedClasses != q_class.size()) {
+        RankClasses();
     }
+    if (!active[index]) {
+        Activate(index);
+    }
+}
 
-    std::cout << "SPQ::Schedule: No packet scheduled (all queues empty)" << std::endl;
-    return {q_class.size(), nullptr};
+/**
+ * @brief Ends the turn of the front class of its level, requeueing it if still backlogged.
+ *
+ * @param index Index of the traffic class, the front of the highest backlogged level.
+ * @param size Size of the dequeued packet, in bytes.
+ */
+void SPQ::NotifyDequeued(uint32_t index, uint32_t size) {
+    uint32_t level = levelOf[index];
+    NS_ASSERT(!levels[level].empty() && levels[level].front() == index);
+    levels[level].pop_front();
+    if (!IsBacklogged(index)) {
+        active[index] = false;
+        Deactivate(level);
+    } else {
+        levels[level].push_back(index);
+    }
 }
 
 /**
- * @brief Classifies a packet to determine the appropriate queue.
+ * @brief Tells whether an arrival outranks the class chosen by the pending decision.
  *
- * Iterates through the traffic class queues and returns the index of the first queue
- * whose filter matches the packet. Logs the classification result and simulation time.
+ * Classes of equal priority take turns, so only a strictly higher priority preempts.
+ */
+bool SPQ::Preempts(uint32_t arrival, uint32_t pending) const {
+    return levelOf[arrival] > levelOf[pending];
+}
+
+/**
+ * @brief Takes over the priority ranks and empty levels of a reloaded configuration.
+ */
+void SPQ::SwapSchedulerState(DiffServ& staged) {
+    SPQ& other = static_cast<SPQ&>(staged);
+    std::swap(levelOf, other.levelOf);
+    std::swap(active, other.active);
+    std::swap(levels, other.levels);
+    std::swap(levelWords, other.levelWords);
+    std::swap(levelSummary, other.levelSummary);
+    std::swap(rankedClasses, other.rankedClasses);
+}
+
+/**
+ * @brief Ranks the distinct priority values and rebuilds the levels for the current classes.
  *
- * @param p Pointer to the packet to be classified.
- * @return The index of the matching queue, or q_class.size() if no queue matches.
+ * Runs when classes are added; classes already backlogged keep their place in service order.
  */
-uint32_t SPQ::Classify(Ptr<Packet> p) {
+void SPQ::RankClasses() {
+    std::vector<uint32_t> priorities;
+    for (const Ptr<TrafficClass>& tc : q_class) {
+        priorities.push_back(tc->GetPriorityLevel());
+    }
+    std::sort(priorities.begin(), priorities.end());
+    priorities.erase(std::unique(priorities.begin(), priorities.end()), priorities.end());
+    NS_ABORT_MSG_IF(priorities.size() > MAX_LEVELS, "SPQ supports at most " << MAX_LEVELS << " priority levels");
+
+    std::vector<uint32_t> backlogged;
+    for (uint32_t level = levels.size(); level-- > 0;) {
+        backlogged.insert(backlogged.end(), levels[level].begin(), levels[level].end());
+    }
+
+    levelOf.resize(q_class.size());
     for (uint32_t i = 0; i < q_class.size(); ++i) {
-        if (q_class[i]->match(p)) {
-            std::cout << "SPQ::Classify: Packet matched queue " << i << " at time " 
-                      << Simulator::Now().GetSeconds() << "s" << std::endl;
-            return i;
-        }
+        levelOf[i] = std::lower_bound(priorities.begin(), priorities.end(), q_class[i]->GetPriorityLevel())
+                   - priorities.begin();
+    }
+    levels.assign(priorities.size(), std::deque<uint32_t>());
+    levelWords.assign((priorities.size() + 63) / 64, 0);
+    levelSummary = 0;
+    active.assign(q_class.size(), false);
+    rankedClasses = q_class.size();
+    for (uint32_t index : backlogged) {
+        Activate(index);
     }
-    std::cout << "SPQ::Classify: Packet dropped (no matching queue) at time " 
-              << Simulator::Now().GetSeconds() << "s" << std::endl;
-    return q_class.size();
+    NS_LOG_INFO("Ranked " << q_class.size() << " queues into " << priorities.size() << " priority levels");
 }
 
-bool SPQ::ReadConfigFile(std::string filename) {
-    std::ifstream file(filename);
-    std::string line;
+void SPQ::Activate(uint32_t index) {
+    uint32_t level = levelOf[index];
+    active[index] = true;
+    levels[level].push_back(index);
+    levelWords[level / 64] |= 1ULL << (level % 64);
+    levelSummary |= 1ULL << (level / 64);
+}
 
-    if (!file.is_open()) {
-        std::cerr << "Failed to open SPQ config file: " << filename << std::endl;
-        return false;
+/**
+ * @brief Clears a level's bit once its FIFO is empty.
+ */
+void SPQ::Deactivate(uint32_t level) {
+    if (!levels[level].empty()) {
+        return;
     }
-
-    while (std::getline(file, line)) {
-        ParseConfigLine(line);
+    levelWords[level / 64] &= ~(1ULL << (level % 64));
+    if (levelWords[level / 64] == 0) {
+        levelSummary &= ~(1ULL << (level / 64));
     }
-    file.close();
+}
 
-    std::cout << "SPQ::ReadConfigFile: Configured " << q_class.size() << " queues" << std::endl;
-    return true;
+/**
+ * @brief Classifies a packet to determine the appropriate queue.
+ *
+ * Looks the packet's flow key up in the compiled classifier, which returns the index of
+ * the first queue whose filter matches, as an in-order scan of the queues would. Logs the
+ * classification result and simulation time.
+ *
+ * @param key Header fields extracted from the packet to be classified.
+ * @return The index of the matching queue, or q_class.size() if no queue matches.
+ */
+uint32_t SPQ::Classify(const FlowKey& key) {
+    uint32_t index = LookupClass(key);
+    if (index < q_class.size()) {
+        NS_LOG_LOGIC("Packet matched queue " << index << " at time "
+                     << Simulator::Now().GetSeconds() << "s");
+    } else {
+        NS_LOG_DEBUG("Packet dropped (no matching queue) at time "
+                     << Simulator::Now().GetSeconds() << "s");
+    }
+    return index;
 }
 
 /**
- * @brief Parses a single line from the configuration file.
+ * @brief Applies one line of the configuration file.
+ *
+ * Declares a queue; queues with a higher priority are served first:
  *
- * Interprets the line to configure a queue (with priority and max packets) or a filter
- * (e.g., source/destination IP, port, or protocol) for a specific queue. Logs the parsing result.
+ *     queue <id> <priority> <maxPackets>
  *
- * @param line The configuration line to parse.
+ * Any other line is handed to DiffServ::ParseConfigLine().
+ *
+ * @param line The line, split into words.
+ * @return True if the line was applied; otherwise the error is recorded on line.
  */
-void SPQ::ParseConfigLine(const std::string& line) {
-    std::istringstream iss(line);
-    std::string token;
-    iss >> token;
-
-    if (token == "queue") {
-        uint32_t queueId, priority, maxPackets;
-        if (iss >> queueId >> priority >> maxPackets) {
-            Ptr<TrafficClass> tc = CreateObject<TrafficClass>();
-            tc->SetPriorityLevel(priority);
-            tc->SetMaxPackets(maxPackets);
-            AddQueue(tc);
-            std::cout << "SPQ::ParseConfigLine: Added queue " << queueId << ", priority=" << priority 
-                      << ", maxPackets=" << maxPackets << std::endl;
-        }
-    } else if (token == "filter") {
-        uint32_t queueId;
-        std::string filterType, value;
-        if (iss >> queueId >> filterType >> value) {
-            Filter* filter = new Filter();
-            if (filterType == "src_ip") {
-                filter->AddElement(new SrcIPAddress(Ipv4Address(value.c_str())));
-            } else if (filterType == "dst_ip") {
-                filter->AddElement(new DstIPAddress(Ipv4Address(value.c_str())));
-            } else if (filterType == "src_port") {
-                filter->AddElement(new SrcPortNumber(std::stoi(value)));
-            } else if (filterType == "dst_port") {
-                filter->AddElement(new DstPortNumber(std::stoi(value)));
-                std::cout << "SPQ::ParseConfigLine: Added filter for dst_port=" << value << " to queue " << queueId << std::endl;
-            } else if (filterType == "protocol") {
-                filter->AddElement(new ProtocolNumber(std::stoi(value)));
-            }
-            if (queueId < q_class.size()) {
-                q_class[queueId]->AddFilter(filter);
-                std::cout << "SPQ::ParseConfigLine: Added filter to queue " << queueId 
-                          << ", type=" << filterType << ", value=" << value << std::endl;
-            } else {
-                std::cerr << "SPQ::ParseConfigLine: Invalid queueId " << queueId << " for filter" << std::endl;
-                delete filter;
-            }
-        }
+bool SPQ::ParseConfigLine(ConfigParser& line) {
+    if (line.GetWord(0) != "queue") {
+        return DiffServ::ParseConfigLine(line);
     }
+    return ParseQueueLine(line, &TrafficClass::SetPriorityLevel);
 }
 
 } // namespace ns3
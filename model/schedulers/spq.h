@@ -4,10 +4,21 @@
 #include "diffserv.h"
 #include "traffic-class.h"
 #include "ns3/ptr.h"
+#include <cstdint>
+#include <deque>
 #include <utility>
+#include <vector>
 
 namespace ns3 {
 
+/**
+ * @brief Strict priority scheduler with O(1) selection.
+ *
+ * The distinct priority values of the classes are ranked, and a two-level bitmap marks
+ * the ranks holding backlogged classes, so the highest one is found with two
+ * count-leading-zeros operations. Classes sharing a priority are served round robin,
+ * one packet per turn, from a FIFO kept per rank.
+ */
 class SPQ : public DiffServ {
 public:
     static TypeId GetTypeId(void);
@@ -15,11 +26,28 @@ public:
     virtual ~SPQ();
 
     virtual std::pair<uint32_t, Ptr<const Packet>> Schedule(void);
-    virtual uint32_t Classify(Ptr<Packet> p);
-    bool ReadConfigFile(std::string filename);
-    virtual void ParseConfigLine(const std::string& line);
+    virtual uint32_t Classify(const FlowKey& key);
+
+protected:
+    bool ParseConfigLine(ConfigParser& line) override;
+    void NotifyEnqueued(uint32_t index, uint32_t size) override;
+    void NotifyDequeued(uint32_t index, uint32_t size) override;
+    bool Preempts(uint32_t arrival, uint32_t pending) const override;
+    void SwapSchedulerState(DiffServ& staged) override;
 
 private:
+    static const uint32_t MAX_LEVELS = 64 * 64;
+
+    void RankClasses();
+    void Activate(uint32_t index);
+    void Deactivate(uint32_t level);
+
+    std::vector<uint32_t> levelOf;                // rank of each class's priority, 0 = lowest
+    std::vector<uint8_t> active;                  // whether each class is in its level's FIFO
+    std::vector<std::deque<uint32_t>> levels;     // backlogged classes per rank, in service order
+    std::vector<uint64_t> levelWords;             // bit set for each rank with backlogged classes
+    uint64_t levelSummary;                        // bit set for each non-zero word of levelWords
+    uint32_t rankedClasses;                       // number of classes when levelOf was computed
 };
 
 } // namespace ns3
@@ -0,0 +1,228 @@
+#include "wfq.h"
+#include "ns3/log.h"
+#include "ns3/string.h"
+#include "ns3/simulator.h"
+#include "ns3/assert.h"
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("WFQ");
+
+NS_OBJECT_ENSURE_REGISTERED(WFQ);
+
+/**
+ * @brief Returns the TypeId for WFQ.
+ *
+ * Registers the WFQ class with the ns-3 object system, setting it as a child of DiffServ
+ * and assigning it to the "Network" group.
+ *
+ * @return The TypeId of the WFQ class.
+ */
+TypeId WFQ::GetTypeId(void) {
+    static TypeId tid = TypeId("ns3::WFQ")
+        .SetParent<DiffServ>()
+        .SetGroupName("Network")
+        .AddConstructor<WFQ>();
+    return tid;
+}
+
+WFQ::WFQ() : virtualTime(0), totalWeight(0), weightedClasses(0), lastActivated(UINT32_MAX) {
+}
+
+WFQ::~WFQ() {
+}
+
+/**
+ * @brief Schedules a packet for dequeuing using WF2Q+.
+ *
+ * Moves the classes whose head packet has become eligible (start time not after the
+ * system virtual time) from the waiting heap to the eligible heap, and returns the head
+ * packet of the eligible class with the smallest finish time. If no class is eligible, the
+ * virtual time first jumps to the smallest start time. Repeated calls return the same
+ * decision until the packet is dequeued. Logs and traces the scheduling decision.
+ *
+ * @return A pair containing the index of the scheduled queue and a pointer to the peeked packet,
+ *         or {q_class.size(), nullptr} if no packet is scheduled.
+ */
+std::pair<uint32_t, Ptr<const Packet>> WFQ::Schedule(void) {
+    while (!eligible.empty() || !waiting.empty()) {
+        if (eligible.empty()) {
+            virtualTime = std::max(virtualTime, waiting.top().first);
+        }
+        while (!waiting.empty() && waiting.top().first <= virtualTime) {
+            uint32_t index = waiting.top().second;
+            waiting.pop();
+            eligible.push(HeapEntry(finishTimes[index], index));
+        }
+        uint32_t index = eligible.top().second;
+        const PacketDescriptor* head = q_class[index]->PeekDescriptor();
+        if (!head) {
+            // Drained behind our back (e.g. by TrafficClass::Dequeue); forget the class.
+            eligible.pop();
+            backlogged[index] = false;
+            continue;
+        }
+        NS_LOG_LOGIC("Scheduled packet from queue " << index << ", size=" << head->size
+                     << ", start=" << startTimes[index] << ", finish=" << finishTimes[index]
+                     << ", virtual time=" << virtualTime);
+        tracer.Record(EventTracer::SCHEDULE, index, head->size);
+        return {index, q_class[index]->Peek()};
+    }
+
+    NS_LOG_LOGIC("No packet scheduled (all queues empty)");
+    return {q_class.size(), nullptr};
+}
+
+/**
+ * @brief Stamps a class that just became backlogged and adds it to the heaps.
+ *
+ * Its head packet starts at the later of the system virtual time and the finish time of
+ * the class's previous packet.
+ *
+ * @param index Index of the traffic class.
+ * @param size Size of the enqueued packet, in bytes.
+ */
+void WFQ::NotifyEnqueued(uint32_t index, uint32_t size) {
+    if (weightedClasses != q_class.size()) {
+        UpdateWeights();
+    }
+    lastActivated = UINT32_MAX;
+    if (backlogged[index]) {
+        return;
+    }
+    backlogged[index] = true;
+    startTimes[index] = std::max(finishTimes[index], virtualTime);
+    finishTimes[index] = startTimes[index] + Span(size, GetWeight(index));
+    Push(index);
+    lastActivated = index;
+}
+
+/**
+ * @brief Advances the virtual time past the dequeued packet and restamps its class.
+ *
+ * @param index Index of the traffic class, the top of the eligible heap.
+ * @param size Size of the dequeued packet, in bytes.
+ */
+void WFQ::NotifyDequeued(uint32_t index, uint32_t size) {
+    NS_ASSERT(!eligible.empty() && eligible.top().second == index);
+    eligible.pop();
+    virtualTime += Span(size, totalWeight);
+    if (!IsBacklogged(index)) {
+        backlogged[index] = false;
+        return;
+    }
+    startTimes[index] = finishTimes[index];
+    finishTimes[index] = startTimes[index] + Span(q_class[index]->PeekDescriptor()->size, GetWeight(index));
+    Push(index);
+}
+
+/**
+ * @brief Tells whether a newly backlogged class should be served before the pending one.
+ *
+ * Arrivals in classes that were already backlogged do not change their head packet, and
+ * the virtual time only advances on dequeue, so only an eligible new class with an
+ * earlier finish time (ties going to the lower index, as in the heap) preempts.
+ */
+bool WFQ::Preempts(uint32_t arrival, uint32_t pending) const {
+    if (arrival != lastActivated || startTimes[arrival] > virtualTime) {
+        return false;
+    }
+    return finishTimes[arrival] < finishTimes[pending]
+        || (finishTimes[arrival] == finishTimes[pending] && arrival < pending);
+}
+
+/**
+ * @brief Takes over the virtual clock and tags of a reloaded configuration, which restart
+ * from zero.
+ */
+void WFQ::SwapSchedulerState(DiffServ& staged) {
+    WFQ& other = static_cast<WFQ&>(staged);
+    std::swap(virtualTime, other.virtualTime);
+    std::swap(startTimes, other.startTimes);
+    std::swap(finishTimes, other.finishTimes);
+    std::swap(backlogged, other.backlogged);
+    std::swap(eligible, other.eligible);
+    std::swap(waiting, other.waiting);
+    std::swap(totalWeight, other.totalWeight);
+    std::swap(weightedClasses, other.weightedClasses);
+    std::swap(lastActivated, other.lastActivated);
+}
+
+void WFQ::Push(uint32_t index) {
+    if (startTimes[index] <= virtualTime) {
+        eligible.push(HeapEntry(finishTimes[index], index));
+    } else {
+        waiting.push(HeapEntry(startTimes[index], index));
+    }
+}
+
+/**
+ * @brief Returns the weight of a class; a weight of zero counts as one.
+ */
+uint32_t WFQ::GetWeight(uint32_t index) const {
+    return std::max<uint32_t>(q_class[index]->GetWeight(), 1);
+}
+
+/**
+ * @brief Virtual time taken by a packet of the given size at the given weight.
+ */
+uint64_t WFQ::Span(uint32_t bytes, uint64_t weight) const {
+    return static_cast<uint64_t>(bytes) * VIRTUAL_TIME_SCALE / weight;
+}
+
+/**
+ * @brief Sizes the per-class state and sums the weights after classes were added.
+ */
+void WFQ::UpdateWeights() {
+    startTimes.resize(q_class.size(), 0);
+    finishTimes.resize(q_class.size(), 0);
+    backlogged.resize(q_class.size(), false);
+    totalWeight = 0;
+    for (uint32_t i = 0; i < q_class.size(); ++i) {
+        totalWeight += GetWeight(i);
+    }
+    weightedClasses = q_class.size();
+    NS_LOG_INFO("Total weight=" << totalWeight << " over " << weightedClasses << " queues");
+}
+
+/**
+ * @brief Classifies a packet to determine the appropriate queue.
+ *
+ * Looks the packet's flow key up in the compiled classifier, which returns the index of
+ * the first queue whose filter matches, as an in-order scan of the queues would. Logs the
+ * classification result.
+ *
+ * @param key Header fields extracted from the packet to be classified.
+ * @return The index of the matching queue, or q_class.size() if no queue matches.
+ */
+uint32_t WFQ::Classify(const FlowKey& key) {
+    uint32_t index = LookupClass(key);
+    if (index < q_class.size()) {
+        NS_LOG_LOGIC("Packet matched queue " << index);
+    } else {
+        NS_LOG_DEBUG("Packet dropped (no matching queue)");
+    }
+    return index;
+}
+
+/**
+ * @brief Applies one line of the configuration file.
+ *
+ * Declares a queue; queues share the link in proportion to their weights:
+ *
+ *     queue <id> <weight> <maxPackets>
+ *
+ * Any other line is handed to DiffServ::ParseConfigLine().
+ *
+ * @param line The line, split into words.
+ * @return True if the line was applied; otherwise the error is recorded on line.
+ */
+bool WFQ::ParseConfigLine(ConfigParser& line) {
+    if (line.GetWord(0) != "queue") {
+        return DiffServ::ParseConfigLine(line);
+    }
+    return ParseQueueLine(line, &TrafficClass::SetWeight);
+}
+
+} // namespace ns3
@@ -0,0 +1,67 @@
+#ifndef WFQ_H
+#define WFQ_H
+
+#include "diffserv.h"
+#include "traffic-class.h"
+#include "ns3/ptr.h"
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+#include <utility>
+
+namespace ns3 {
+
+/**
+ * @brief Worst-case fair weighted fair queueing (WF2Q+, Bennett and Zhang).
+ *
+ * Each backlogged class is stamped with the virtual start and finish time of its head
+ * packet, and the eligible class (start time not after the system virtual time) with the
+ * smallest finish time is served. Classes are kept in two binary heaps, eligible ones by
+ * finish time and waiting ones by start time, so a decision costs O(log classes): about
+ * a dozen levels at thousands of classes. A radix heap would need finish times to leave
+ * in increasing order, which WF2Q+ does not guarantee once waiting classes turn eligible,
+ * and a calendar queue needs its bucket width tuned to the spread of weights and sizes.
+ * Weights are read from the TrafficClass, as configured for DRR.
+ */
+class WFQ : public DiffServ {
+public:
+    static TypeId GetTypeId(void);
+    WFQ();
+    virtual ~WFQ();
+
+    virtual std::pair<uint32_t, Ptr<const Packet>> Schedule(void);
+    virtual uint32_t Classify(const FlowKey& key);
+
+protected:
+    bool ParseConfigLine(ConfigParser& line) override;
+    void NotifyEnqueued(uint32_t index, uint32_t size) override;
+    void NotifyDequeued(uint32_t index, uint32_t size) override;
+    bool Preempts(uint32_t arrival, uint32_t pending) const override;
+    void SwapSchedulerState(DiffServ& staged) override;
+
+private:
+    typedef std::pair<uint64_t, uint32_t> HeapEntry;  // (virtual time, class index)
+    typedef std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> MinHeap;
+
+    static const uint64_t VIRTUAL_TIME_SCALE = 1 << 16;  // virtual time units per byte at full weight
+
+    void Push(uint32_t index);
+    uint32_t GetWeight(uint32_t index) const;
+    uint64_t Span(uint32_t bytes, uint64_t weight) const;
+    void UpdateWeights();
+
+    uint64_t virtualTime;
+    std::vector<uint64_t> startTimes;   // of each class's head packet
+    std::vector<uint64_t> finishTimes;  // of each class's head packet, or its last one if idle
+    std::vector<uint8_t> backlogged;
+    MinHeap eligible;                   // by finish time
+    MinHeap waiting;                    // by start time
+    uint64_t totalWeight;
+    uint32_t weightedClasses;           // number of classes when totalWeight was computed
+    uint32_t lastActivated;             // class made backlogged by the last enqueue, if any
+};
+
+} // namespace ns3
+
+#endif // WFQ_H
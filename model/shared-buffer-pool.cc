@@ -0,0 +1,155 @@
+#include "shared-buffer-pool.h"
+#include <algorithm>
+
+namespace ns3 {
+
+SharedBufferPool::SharedBufferPool()
+    : m_size(0), m_defaultAlpha(1.0), m_reserved(0), m_used(0), m_sharedUsed(0) {
+}
+
+/**
+ * @brief Sets the total buffer size; zero disables byte accounting.
+ *
+ * @param bytes Size of the buffer, in bytes, guarantees included.
+ */
+void SharedBufferPool::SetSize(uint64_t bytes) {
+    m_size = bytes;
+}
+
+uint64_t SharedBufferPool::GetSize() const {
+    return m_size;
+}
+
+bool SharedBufferPool::IsEnabled() const {
+    return m_size > 0;
+}
+
+/**
+ * @brief Sets the alpha of classes that have none of their own.
+ *
+ * Larger values let a single class take more of the free space; with n busy classes of
+ * equal alpha, each settles at alpha / (1 + n * alpha) of the shared space.
+ */
+void SharedBufferPool::SetDefaultAlpha(double alpha) {
+    m_defaultAlpha = alpha;
+}
+
+double SharedBufferPool::GetDefaultAlpha() const {
+    return m_defaultAlpha;
+}
+
+/**
+ * @brief Adds an empty class with no guarantee and the default alpha.
+ */
+void SharedBufferPool::AddClass() {
+    m_classes.push_back({0, 0, -1.0, 0});
+}
+
+/**
+ * @brief Sets the bytes reserved for a class, which it can always fill.
+ *
+ * @param index Index of the class.
+ * @param bytes The guaranteed minimum, in bytes.
+ */
+void SharedBufferPool::SetGuarantee(uint32_t index, uint64_t bytes) {
+    ClassState& state = m_classes[index];
+    m_sharedUsed -= SharedPart(state, state.occupancy);
+    m_reserved = m_reserved - state.guarantee + bytes;
+    state.guarantee = bytes;
+    m_sharedUsed += SharedPart(state, state.occupancy);
+}
+
+uint64_t SharedBufferPool::GetGuarantee(uint32_t index) const {
+    return m_classes[index].guarantee;
+}
+
+/**
+ * @brief Sets a class's alpha; a negative value reverts to the pool's default.
+ */
+void SharedBufferPool::SetAlpha(uint32_t index, double alpha) {
+    m_classes[index].alpha = alpha;
+}
+
+/**
+ * @brief Charges a packet to a class if the buffer can take it.
+ *
+ * Bytes within the class's guarantee are always admitted. Bytes beyond it must fit in
+ * the shared space, and the class's shared bytes must stay within alpha times the shared
+ * space still free. The bytes are counted even while the pool is disabled, so that
+ * Release() stays symmetric and a size set mid-run starts from the real occupancy.
+ *
+ * @param index Index of the class.
+ * @param bytes Size of the packet, in bytes.
+ * @return True if the packet was admitted and charged, false if it must be dropped.
+ */
+bool SharedBufferPool::Admit(uint32_t index, uint32_t bytes) {
+    ClassState& state = m_classes[index];
+    uint64_t shared = SharedPart(state, state.occupancy);
+    uint64_t extra = SharedPart(state, state.occupancy + bytes) - shared;
+    if (IsEnabled() && extra > 0) {
+        uint64_t available = GetSharedSize() - std::min(GetSharedSize(), m_sharedUsed);
+        if (extra > available || shared + extra > GetAlpha(state) * available) {
+            state.drops++;
+            return false;
+        }
+    }
+    m_sharedUsed += extra;
+    state.occupancy += bytes;
+    m_used += bytes;
+    return true;
+}
+
+/**
+ * @brief Returns a packet's bytes to the buffer when it leaves its class.
+ *
+ * @param index Index of the class.
+ * @param bytes Bytes that left the class: the packet, plus any its AQM dropped.
+ */
+void SharedBufferPool::Release(uint32_t index, uint64_t bytes) {
+    ClassState& state = m_classes[index];
+    bytes = std::min<uint64_t>(bytes, state.occupancy);
+    m_sharedUsed -= SharedPart(state, state.occupancy) - SharedPart(state, state.occupancy - bytes);
+    state.occupancy -= bytes;
+    m_used -= bytes;
+}
+
+/**
+ * @brief Returns the bytes a class currently holds.
+ */
+uint64_t SharedBufferPool::GetOccupancy(uint32_t index) const {
+    return m_classes[index].occupancy;
+}
+
+/**
+ * @brief Returns the occupancy beyond which the class's next packet would be dropped now.
+ */
+uint64_t SharedBufferPool::GetThreshold(uint32_t index) const {
+    const ClassState& state = m_classes[index];
+    uint64_t available = GetSharedSize() - std::min(GetSharedSize(), m_sharedUsed);
+    return state.guarantee + static_cast<uint64_t>(GetAlpha(state) * available);
+}
+
+uint64_t SharedBufferPool::GetUsed() const {
+    return m_used;
+}
+
+/**
+ * @brief Returns the number of packets of a class the pool refused.
+ */
+uint64_t SharedBufferPool::GetDrops(uint32_t index) const {
+    return m_classes[index].drops;
+}
+
+uint64_t SharedBufferPool::SharedPart(const ClassState& state, uint64_t occupancy) const {
+    return occupancy > state.guarantee ? occupancy - state.guarantee : 0;
+}
+
+uint64_t SharedBufferPool::GetSharedSize() const {
+    return m_size > m_reserved ? m_size - m_reserved : 0;
+}
+
+double SharedBufferPool::GetAlpha(const ClassState& state) const {
+    return state.alpha < 0 ? m_defaultAlpha : state.alpha;
+}
+
+} // namespace ns3
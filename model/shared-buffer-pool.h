@@ -0,0 +1,64 @@
+#ifndef SHARED_BUFFER_POOL_H
+#define SHARED_BUFFER_POOL_H
+
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * @brief Byte-accounted buffer shared by the traffic classes of a queue.
+ *
+ * Each class owns a guaranteed minimum; the rest of the buffer is shared, and a class
+ * may hold shared bytes up to a dynamic threshold of alpha times the free shared space
+ * (Choudhury and Hahne, "Dynamic queue length thresholds for shared-memory packet
+ * switches"). Busy classes are thus throttled as the buffer fills, while an idle
+ * class's space stays available to the others. A pool of size zero is disabled and
+ * admits everything.
+ */
+class SharedBufferPool {
+public:
+    SharedBufferPool();
+
+    void SetSize(uint64_t bytes);
+    uint64_t GetSize() const;
+    bool IsEnabled() const;
+    void SetDefaultAlpha(double alpha);
+    double GetDefaultAlpha() const;
+
+    void AddClass();
+    void SetGuarantee(uint32_t index, uint64_t bytes);
+    uint64_t GetGuarantee(uint32_t index) const;
+    void SetAlpha(uint32_t index, double alpha);
+
+    bool Admit(uint32_t index, uint32_t bytes);
+    void Release(uint32_t index, uint64_t bytes);
+
+    uint64_t GetOccupancy(uint32_t index) const;
+    uint64_t GetThreshold(uint32_t index) const;
+    uint64_t GetUsed() const;
+    uint64_t GetDrops(uint32_t index) const;
+
+private:
+    struct ClassState {
+        uint64_t occupancy;
+        uint64_t guarantee;
+        double alpha;         // negative: use the pool's default
+        uint64_t drops;
+    };
+
+    uint64_t SharedPart(const ClassState& state, uint64_t occupancy) const;
+    uint64_t GetSharedSize() const;
+    double GetAlpha(const ClassState& state) const;
+
+    uint64_t m_size;
+    double m_defaultAlpha;
+    uint64_t m_reserved;      // sum of the guarantees
+    uint64_t m_used;          // bytes held by all classes
+    uint64_t m_sharedUsed;    // bytes held beyond the classes' guarantees
+    std::vector<ClassState> m_classes;
+};
+
+} // namespace ns3
+
+#endif /* SHARED_BUFFER_POOL_H */
@@ -4,26 +4,76 @@
 #include "ns3/point-to-point-module.h"
 #include "ns3/applications-module.h"
 #include "ns3/flow-monitor-module.h"
+#include "ns3/traffic-control-module.h"
 #include "drr.h"
+#include "drr-queue-disc.h"
+#include "experiment-metrics.h"
 #include <fstream>
 
 using namespace ns3;
 
+NS_LOG_COMPONENT_DEFINE("DrrSimulation");
+
 void PacketSentCallback(Ptr<const Packet> packet) {
-    std::cout << "Packet sent at time " << Simulator::Now().GetSeconds() << "s, size=" << packet->GetSize() << " bytes" << std::endl;
+    NS_LOG_INFO("Packet sent at time " << Simulator::Now().GetSeconds() << "s, size=" << packet->GetSize() << " bytes");
 }
 
 void PacketReceivedCallback(Ptr<const Packet> packet, const Address &address) {
-    std::cout << "Packet received at time " << Simulator::Now().GetSeconds() << "s, size=" << packet->GetSize() 
-              << " bytes, from address " << address << std::endl;
+    NS_LOG_INFO("Packet received at time " << Simulator::Now().GetSeconds() << "s, size=" << packet->GetSize()
+                << " bytes, from address " << address);
+}
+
+/**
+ * @brief Installs the on-off sources of one application.
+ *
+ * The application's data rate is split evenly over its sources, and each source starts
+ * after a random delay of up to the given jitter.
+ */
+ApplicationContainer InstallSources(Ptr<Node> node, Address destination, DataRate rate, uint32_t flows,
+                                    Time start, Time stop, Ptr<UniformRandomVariable> jitter) {
+    OnOffHelper onOff("ns3::UdpSocketFactory", destination);
+    onOff.SetAttribute("OnTime", StringValue("ns3::ConstantRandomVariable[Constant=1]"));
+    onOff.SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=0]"));
+    onOff.SetAttribute("DataRate", DataRateValue(DataRate(rate.GetBitRate() / flows)));
+    onOff.SetAttribute("PacketSize", UintegerValue(1024));
+    ApplicationContainer clients;
+    for (uint32_t i = 0; i < flows; ++i) {
+        ApplicationContainer client = onOff.Install(node);
+        client.Start(start + Seconds(jitter->GetValue()));
+        client.Stop(stop);
+        clients.Add(client);
+    }
+    return clients;
 }
 
 int main(int argc, char* argv[]) {
-    // Parse command-line arguments for config file
+    // Parse command-line arguments; the config file and optional event trace file are
+    // positional, the RNG run is set with --RngRun
     std::string configFile = "drr-config.txt";
-    if (argc > 1) {
-        configFile = argv[1];
-    }
+    std::string traceFile;
+    std::string bottleneckRate = "1Mbps";
+    uint32_t flows = 1;
+    double startJitter = 0;
+    bool pcap = true;
+    std::string maxSize;
+    bool qdisc = false;
+    bool bql = false;
+    std::string reloadConfig;
+    double reloadAt = 75;
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("bottleneckRate", "Data rate of the router to Host2 link", bottleneckRate);
+    cmd.AddValue("flows", "On-off sources per application, sharing its data rate", flows);
+    cmd.AddValue("startJitter", "Maximum random delay of each source's start, in seconds", startJitter);
+    cmd.AddValue("pcap", "Write pcap files", pcap);
+    cmd.AddValue("qdisc", "Install DRR as a queue disc instead of replacing the device queue", qdisc);
+    cmd.AddValue("bql", "Enable byte queue limits on the router's device queue (with --qdisc)", bql);
+    cmd.AddValue("maxSize", "Packets or bytes all queues may hold together, e.g. 200p (default: sum of queue limits; ignored with --qdisc)", maxSize);
+    cmd.AddValue("reloadConfig", "Config file the queue switches to during the run, keeping its queued packets", reloadConfig);
+    cmd.AddValue("reloadAt", "Time of the switch to --reloadConfig, in seconds", reloadAt);
+    cmd.AddNonOption("config", "DRR config file", configFile);
+    cmd.AddNonOption("trace", "Binary event trace file", traceFile);
+    cmd.Parse(argc, argv);
+    flows = std::max<uint32_t>(flows, 1);
 
     // Create nodes
     NodeContainer nodes;
@@ -35,25 +85,47 @@ int main(int argc, char* argv[]) {
     p2p.SetChannelAttribute("Delay", StringValue("2ms"));
     NetDeviceContainer dev01 = p2p.Install(nodes.Get(0), nodes.Get(1)); // Host1 to Router
 
-    p2p.SetDeviceAttribute("DataRate", StringValue("1Mbps"));
+    p2p.SetDeviceAttribute("DataRate", StringValue(bottleneckRate));
     NetDeviceContainer dev12 = p2p.Install(nodes.Get(1), nodes.Get(2)); // Router to Host2
 
     // Install Internet stack
     InternetStackHelper stack;
     stack.Install(nodes);
 
-    // Install DRR on router
-    Ptr<DRR> drr = CreateObject<DRR>();
-    if (!drr->ReadConfigFile(configFile)) {
-        std::cerr << "Failed to read DRR config file: " << configFile << std::endl;
-        return 1;
+    // Install DRR on router, either in place of the device queue or as a queue disc in
+    // front of it; the queue disc reads its config file when it is initialized
+    Ptr<DRR> drr;
+    if (qdisc) {
+        TrafficControlHelper tch;
+        tch.SetRootQueueDisc("ns3::DrrQueueDisc", "ConfigFile", StringValue(configFile));
+        if (bql) {
+            tch.SetQueueLimits("ns3::DynamicQueueLimits");
+        }
+        QueueDiscContainer qdiscs = tch.Install(dev12.Get(0));
+        drr = DynamicCast<DRR>(DynamicCast<DiffServQueueDisc>(qdiscs.Get(0))->GetScheduler());
+    } else {
+        drr = CreateObject<DRR>();
+        if (!drr->ReadConfigFile(configFile)) {
+            std::cerr << "Failed to read DRR config file: " << configFile << std::endl;
+            return 1;
+        }
+        if (!maxSize.empty()) {
+            drr->SetMaxSize(QueueSize(maxSize));
+        }
+        Ptr<PointToPointNetDevice> routerDev = DynamicCast<PointToPointNetDevice>(dev12.Get(0));
+        if (!routerDev) {
+            std::cerr << "Failed to cast NetDevice to PointToPointNetDevice" << std::endl;
+            return 1;
+        }
+        routerDev->SetQueue(drr);
     }
-    Ptr<PointToPointNetDevice> routerDev = DynamicCast<PointToPointNetDevice>(dev12.Get(0));
-    if (!routerDev) {
-        std::cerr << "Failed to cast NetDevice to PointToPointNetDevice" << std::endl;
+    if (!traceFile.empty() && !drr->EnableEventTrace(traceFile)) {
+        std::cerr << "Failed to open event trace file: " << traceFile << std::endl;
         return 1;
     }
-    routerDev->SetQueue(drr);
+    if (!reloadConfig.empty()) {
+        drr->ScheduleReload(Seconds(reloadAt), reloadConfig);
+    }
 
     // Assign IP addresses
     Ipv4AddressHelper ipv4;
@@ -70,15 +142,12 @@ int main(int argc, char* argv[]) {
     uint16_t port2 = 7000; // Weight 200
     uint16_t port3 = 9000; // Weight 300
 
+    Ptr<UniformRandomVariable> jitter = CreateObject<UniformRandomVariable>();
+    jitter->SetAttribute("Max", DoubleValue(startJitter));
+
     // Application 1 (port 6000, weight 100)
-    OnOffHelper onOff1("ns3::UdpSocketFactory", InetSocketAddress(if12.GetAddress(1), port1));
-    onOff1.SetAttribute("OnTime", StringValue("ns3::ConstantRandomVariable[Constant=1]"));
-    onOff1.SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=0]"));
-    onOff1.SetAttribute("DataRate", StringValue("2Mbps"));
-    onOff1.SetAttribute("PacketSize", UintegerValue(1024));
-    ApplicationContainer client1 = onOff1.Install(nodes.Get(0));
-    client1.Start(Seconds(1.0));
-    client1.Stop(Seconds(30.0));
+    ApplicationContainer client1 = InstallSources(nodes.Get(0), InetSocketAddress(if12.GetAddress(1), port1),
+                                                  DataRate("2Mbps"), flows, Seconds(1.0), Seconds(30.0), jitter);
 
     PacketSinkHelper sink1("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), port1));
     ApplicationContainer server1 = sink1.Install(nodes.Get(2));
@@ -86,14 +155,8 @@ int main(int argc, char* argv[]) {
     server1.Stop(Seconds(150.0));
 
     // Application 2 (port 7000, weight 200)
-    OnOffHelper onOff2("ns3::UdpSocketFactory", InetSocketAddress(if12.GetAddress(1), port2));
-    onOff2.SetAttribute("OnTime", StringValue("ns3::ConstantRandomVariable[Constant=1]"));
-    onOff2.SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=0]"));
-    onOff2.SetAttribute("DataRate", StringValue("2Mbps"));
-    onOff2.SetAttribute("PacketSize", UintegerValue(1024));
-    ApplicationContainer client2 = onOff2.Install(nodes.Get(0));
-    client2.Start(Seconds(1.0));
-    client2.Stop(Seconds(30.0));
+    ApplicationContainer client2 = InstallSources(nodes.Get(0), InetSocketAddress(if12.GetAddress(1), port2),
+                                                  DataRate("2Mbps"), flows, Seconds(1.0), Seconds(30.0), jitter);
 
     PacketSinkHelper sink2("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), port2));
     ApplicationContainer server2 = sink2.Install(nodes.Get(2));
@@ -101,14 +164,8 @@ int main(int argc, char* argv[]) {
     server2.Stop(Seconds(150.0));
 
     // Application 3 (port 9000, weight 300)
-    OnOffHelper onOff3("ns3::UdpSocketFactory", InetSocketAddress(if12.GetAddress(1), port3));
-    onOff3.SetAttribute("OnTime", StringValue("ns3::ConstantRandomVariable[Constant=1]"));
-    onOff3.SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=0]"));
-    onOff3.SetAttribute("DataRate", StringValue("2Mbps"));
-    onOff3.SetAttribute("PacketSize", UintegerValue(1024));
-    ApplicationContainer client3 = onOff3.Install(nodes.Get(0));
-    client3.Start(Seconds(1.0));
-    client3.Stop(Seconds(30.0));
+    ApplicationContainer client3 = InstallSources(nodes.Get(0), InetSocketAddress(if12.GetAddress(1), port3),
+                                                  DataRate("2Mbps"), flows, Seconds(1.0), Seconds(30.0), jitter);
 
     PacketSinkHelper sink3("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), port3));
     ApplicationContainer server3 = sink3.Install(nodes.Get(2));
@@ -116,16 +173,20 @@ int main(int argc, char* argv[]) {
     server3.Stop(Seconds(150.0));
 
     // Trace packet transmissions and receptions
-    client1.Get(0)->TraceConnectWithoutContext("Tx", MakeCallback(&PacketSentCallback));
-    client2.Get(0)->TraceConnectWithoutContext("Tx", MakeCallback(&PacketSentCallback));
-    client3.Get(0)->TraceConnectWithoutContext("Tx", MakeCallback(&PacketSentCallback));
+    for (uint32_t i = 0; i < flows; ++i) {
+        client1.Get(i)->TraceConnectWithoutContext("Tx", MakeCallback(&PacketSentCallback));
+        client2.Get(i)->TraceConnectWithoutContext("Tx", MakeCallback(&PacketSentCallback));
+        client3.Get(i)->TraceConnectWithoutContext("Tx", MakeCallback(&PacketSentCallback));
+    }
     server1.Get(0)->TraceConnectWithoutContext("Rx", MakeCallback(&PacketReceivedCallback));
     server2.Get(0)->TraceConnectWithoutContext("Rx", MakeCallback(&PacketReceivedCallback));
     server3.Get(0)->TraceConnectWithoutContext("Rx", MakeCallback(&PacketReceivedCallback));
 
     // Enable PCAP tracing
-    p2p.EnablePcap("predrr", dev01.Get(0));
-    p2p.EnablePcap("postdrr", dev12.Get(1));
+    if (pcap) {
+        p2p.EnablePcap("predrr", dev01.Get(0));
+        p2p.EnablePcap("postdrr", dev12.Get(1));
+    }
 
     // Install FlowMonitor
     FlowMonitorHelper flowmonHelper;
@@ -134,6 +195,9 @@ int main(int argc, char* argv[]) {
     // Run simulation
     Simulator::Stop(Seconds(150.0));
     Simulator::Run();
+
+    // Report per-port and per-queue metrics
+    PrintRunMetrics(monitor, DynamicCast<Ipv4FlowClassifier>(flowmonHelper.GetClassifier()), drr);
     Simulator::Destroy();
 
     return 0;
@@ -0,0 +1,71 @@
+#ifndef EXPERIMENT_METRICS_H
+#define EXPERIMENT_METRICS_H
+
+#include "ns3/core-module.h"
+#include "ns3/flow-monitor-module.h"
+#include "diffserv.h"
+#include <iostream>
+#include <map>
+
+namespace ns3 {
+
+/**
+ * @brief Prints the results of a finished simulation run, one "metric <name> <value>" line each.
+ *
+ * Per destination port: throughput from the first transmitted to the last received
+ * packet, mean one-way delay and lost packets, summed over the port's flows. Per queue:
+ * mean, max and p50/p99/p99.9 sojourn time, p99 queue length in packets, and AQM drops
+ * and marks. The experiment-runner tool aggregates these lines across runs.
+ *
+ * @param monitor The flow monitor installed on all nodes.
+ * @param classifier The flow monitor's IPv4 classifier.
+ * @param queue The DiffServ queue of the bottleneck link.
+ */
+inline void PrintRunMetrics(Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier, Ptr<DiffServ> queue) {
+    struct PortStats {
+        uint64_t rxBytes = 0;
+        uint64_t rxPackets = 0;
+        uint64_t lostPackets = 0;
+        Time delaySum;
+        Time firstTx = Time::Max();
+        Time lastRx;
+    };
+    std::map<uint16_t, PortStats> ports;
+    monitor->CheckForLostPackets();
+    for (const auto& [id, flow] : monitor->GetFlowStats()) {
+        PortStats& port = ports[classifier->FindFlow(id).destinationPort];
+        port.rxBytes += flow.rxBytes;
+        port.rxPackets += flow.rxPackets;
+        port.lostPackets += flow.lostPackets;
+        port.delaySum += flow.delaySum;
+        port.firstTx = std::min(port.firstTx, flow.timeFirstTxPacket);
+        port.lastRx = std::max(port.lastRx, flow.timeLastRxPacket);
+    }
+    for (const auto& [number, port] : ports) {
+        double seconds = (port.lastRx - port.firstTx).GetSeconds();
+        std::string prefix = "port" + std::to_string(number) + "_";
+        std::cout << "metric " << prefix << "throughput_mbps "
+                  << (seconds > 0 ? port.rxBytes * 8 / seconds / 1e6 : 0) << "\n"
+                  << "metric " << prefix << "mean_delay_ms "
+                  << (port.rxPackets ? port.delaySum.GetSeconds() * 1e3 / port.rxPackets : 0) << "\n"
+                  << "metric " << prefix << "lost_packets " << port.lostPackets << "\n";
+    }
+
+    std::vector<Ptr<TrafficClass>> queues = queue->GetQueues();
+    for (uint32_t i = 0; i < queues.size(); ++i) {
+        std::string prefix = "queue" + std::to_string(i) + "_";
+        std::cout << "metric " << prefix << "mean_sojourn_ms " << queues[i]->GetMeanSojournTime().GetSeconds() * 1e3 << "\n"
+                  << "metric " << prefix << "max_sojourn_ms " << queues[i]->GetMaxSojournTime().GetSeconds() * 1e3 << "\n"
+                  << "metric " << prefix << "p50_sojourn_ms " << queues[i]->GetSojournHistogram().GetPercentile(50) / 1e6 << "\n"
+                  << "metric " << prefix << "p99_sojourn_ms " << queues[i]->GetSojournHistogram().GetPercentile(99) / 1e6 << "\n"
+                  << "metric " << prefix << "p999_sojourn_ms " << queues[i]->GetSojournHistogram().GetPercentile(99.9) / 1e6 << "\n"
+                  << "metric " << prefix << "p99_packets " << queues[i]->GetPacketOccupancyHistogram().GetPercentile(99) << "\n"
+                  << "metric " << prefix << "aqm_drops " << queues[i]->GetAqmDrops() << "\n"
+                  << "metric " << prefix << "aqm_marks " << queues[i]->GetAqmMarks() << "\n";
+    }
+    std::cout.flush();
+}
+
+} // namespace ns3
+
+#endif /* EXPERIMENT_METRICS_H */
@@ -4,26 +4,76 @@
 #include "ns3/point-to-point-module.h"
 #include "ns3/applications-module.h"
 #include "ns3/flow-monitor-module.h"
+#include "ns3/traffic-control-module.h"
 #include "spq.h"
+#include "spq-queue-disc.h"
+#include "experiment-metrics.h"
 #include <fstream>
 
 using namespace ns3;
 
+NS_LOG_COMPONENT_DEFINE("SpqSimulation");
+
 void PacketSentCallback(Ptr<const Packet> packet) {
-    std::cout << "Packet sent at time " << Simulator::Now().GetSeconds() << "s, size=" << packet->GetSize() << " bytes" << std::endl;
+    NS_LOG_INFO("Packet sent at time " << Simulator::Now().GetSeconds() << "s, size=" << packet->GetSize() << " bytes");
 }
 
 void PacketReceivedCallback(Ptr<const Packet> packet, const Address &address) {
-    std::cout << "Packet received at time " << Simulator::Now().GetSeconds() << "s, size=" << packet->GetSize() 
-              << " bytes, from address " << address << std::endl;
+    NS_LOG_INFO("Packet received at time " << Simulator::Now().GetSeconds() << "s, size=" << packet->GetSize()
+                << " bytes, from address " << address);
+}
+
+/**
+ * @brief Installs the on-off sources of one application.
+ *
+ * The application's data rate is split evenly over its sources, and each source starts
+ * after a random delay of up to the given jitter.
+ */
+ApplicationContainer InstallSources(Ptr<Node> node, Address destination, DataRate rate, uint32_t flows,
+                                    Time start, Time stop, Ptr<UniformRandomVariable> jitter) {
+    OnOffHelper onOff("ns3::UdpSocketFactory", destination);
+    onOff.SetAttribute("OnTime", StringValue("ns3::ConstantRandomVariable[Constant=1]"));
+    onOff.SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=0]"));
+    onOff.SetAttribute("DataRate", DataRateValue(DataRate(rate.GetBitRate() / flows)));
+    onOff.SetAttribute("PacketSize", UintegerValue(1024));
+    ApplicationContainer clients;
+    for (uint32_t i = 0; i < flows; ++i) {
+        ApplicationContainer client = onOff.Install(node);
+        client.Start(start + Seconds(jitter->GetValue()));
+        client.Stop(stop);
+        clients.Add(client);
+    }
+    return clients;
 }
 
 int main(int argc, char* argv[]) {
-    // Parse command-line arguments for config file
+    // Parse command-line arguments; the config file and optional event trace file are
+    // positional, the RNG run is set with --RngRun
     std::string configFile = "spq-config.txt";
-    if (argc > 1) {
-        configFile = argv[1];
-    }
+    std::string traceFile;
+    std::string bottleneckRate = "1Mbps";
+    uint32_t flows = 1;
+    double startJitter = 0;
+    bool pcap = true;
+    std::string maxSize;
+    bool qdisc = false;
+    bool bql = false;
+    std::string reloadConfig;
+    double reloadAt = 75;
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("bottleneckRate", "Data rate of the router to Host2 link", bottleneckRate);
+    cmd.AddValue("flows", "On-off sources per application, sharing its data rate", flows);
+    cmd.AddValue("startJitter", "Maximum random delay of each source's start, in seconds", startJitter);
+    cmd.AddValue("pcap", "Write pcap files", pcap);
+    cmd.AddValue("qdisc", "Install SPQ as a queue disc instead of replacing the device queue", qdisc);
+    cmd.AddValue("bql", "Enable byte queue limits on the router's device queue (with --qdisc)", bql);
+    cmd.AddValue("maxSize", "Packets or bytes all queues may hold together, e.g. 200p (default: sum of queue limits; ignored with --qdisc)", maxSize);
+    cmd.AddValue("reloadConfig", "Config file the queue switches to during the run, keeping its queued packets", reloadConfig);
+    cmd.AddValue("reloadAt", "Time of the switch to --reloadConfig, in seconds", reloadAt);
+    cmd.AddNonOption("config", "SPQ config file", configFile);
+    cmd.AddNonOption("trace", "Binary event trace file", traceFile);
+    cmd.Parse(argc, argv);
+    flows = std::max<uint32_t>(flows, 1);
 
     // Create nodes
     NodeContainer nodes;
@@ -35,25 +85,47 @@ int main(int argc, char* argv[]) {
     p2p.SetChannelAttribute("Delay", StringValue("2ms"));
     NetDeviceContainer dev01 = p2p.Install(nodes.Get(0), nodes.Get(1));
 
-    p2p.SetDeviceAttribute("DataRate", StringValue("1Mbps"));
+    p2p.SetDeviceAttribute("DataRate", StringValue(bottleneckRate));
     NetDeviceContainer dev12 = p2p.Install(nodes.Get(1), nodes.Get(2));
 
     // Install Internet stack
     InternetStackHelper stack;
     stack.Install(nodes);
 
-    // Install SPQ on router
-    Ptr<SPQ> spq = CreateObject<SPQ>();
-    if (!spq->ReadConfigFile(configFile)) {
-        std::cerr << "Failed to read SPQ config file: " << configFile << std::endl;
-        return 1;
+    // Install SPQ on router, either in place of the device queue or as a queue disc in
+    // front of it; the queue disc reads its config file when it is initialized
+    Ptr<SPQ> spq;
+    if (qdisc) {
+        TrafficControlHelper tch;
+        tch.SetRootQueueDisc("ns3::SpqQueueDisc", "ConfigFile", StringValue(configFile));
+        if (bql) {
+            tch.SetQueueLimits("ns3::DynamicQueueLimits");
+        }
+        QueueDiscContainer qdiscs = tch.Install(dev12.Get(0));
+        spq = DynamicCast<SPQ>(DynamicCast<DiffServQueueDisc>(qdiscs.Get(0))->GetScheduler());
+    } else {
+        spq = CreateObject<SPQ>();
+        if (!spq->ReadConfigFile(configFile)) {
+            std::cerr << "Failed to read SPQ config file: " << configFile << std::endl;
+            return 1;
+        }
+        if (!maxSize.empty()) {
+            spq->SetMaxSize(QueueSize(maxSize));
+        }
+        Ptr<PointToPointNetDevice> routerDev = DynamicCast<PointToPointNetDevice>(dev12.Get(0));
+        if (!routerDev) {
+            std::cerr << "Failed to cast NetDevice to PointToPointNetDevice" << std::endl;
+            return 1;
+        }
+        routerDev->SetQueue(spq);
     }
-    Ptr<PointToPointNetDevice> routerDev = DynamicCast<PointToPointNetDevice>(dev12.Get(0));
-    if (!routerDev) {
-        std::cerr << "Failed to cast NetDevice to PointToPointNetDevice" << std::endl;
+    if (!traceFile.empty() && !spq->EnableEventTrace(traceFile)) {
+        std::cerr << "Failed to open event trace file: " << traceFile << std::endl;
         return 1;
     }
-    routerDev->SetQueue(spq);
+    if (!reloadConfig.empty()) {
+        spq->ScheduleReload(Seconds(reloadAt), reloadConfig);
+    }
 
     // Assign IP addresses
     Ipv4AddressHelper ipv4;
@@ -69,15 +141,12 @@ int main(int argc, char* argv[]) {
     uint16_t portLow = 7000;
     uint16_t portHigh = 9000;
 
+    Ptr<UniformRandomVariable> jitter = CreateObject<UniformRandomVariable>();
+    jitter->SetAttribute("Max", DoubleValue(startJitter));
+
     // Application Low Priority (port 7000, starts at t=1)
-    OnOffHelper onOffLow("ns3::UdpSocketFactory", InetSocketAddress(if12.GetAddress(1), portLow));
-    onOffLow.SetAttribute("OnTime", StringValue("ns3::ConstantRandomVariable[Constant=1]"));
-    onOffLow.SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=0]"));
-    onOffLow.SetAttribute("DataRate", StringValue("4Mbps"));
-    onOffLow.SetAttribute("PacketSize", UintegerValue(1024));
-    ApplicationContainer clientLow = onOffLow.Install(nodes.Get(0));
-    clientLow.Start(Seconds(1.0));
-    clientLow.Stop(Seconds(30.0));
+    ApplicationContainer clientLow = InstallSources(nodes.Get(0), InetSocketAddress(if12.GetAddress(1), portLow),
+                                                    DataRate("4Mbps"), flows, Seconds(1.0), Seconds(30.0), jitter);
 
     PacketSinkHelper sinkLow("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), portLow));
     ApplicationContainer serverLow = sinkLow.Install(nodes.Get(2));
@@ -85,14 +154,8 @@ int main(int argc, char* argv[]) {
     serverLow.Stop(Seconds(150.0));
 
     // Application High Priority (port 9000, starts at t=14, stops at t=30)
-    OnOffHelper onOffHigh("ns3::UdpSocketFactory", InetSocketAddress(if12.GetAddress(1), portHigh));
-    onOffHigh.SetAttribute("OnTime", StringValue("ns3::ConstantRandomVariable[Constant=1]"));
-    onOffHigh.SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=0]"));
-    onOffHigh.SetAttribute("DataRate", StringValue("4Mbps"));
-    onOffHigh.SetAttribute("PacketSize", UintegerValue(1024));
-    ApplicationContainer clientHigh = onOffHigh.Install(nodes.Get(0));
-    clientHigh.Start(Seconds(14.0));
-    clientHigh.Stop(Seconds(30.0));
+    ApplicationContainer clientHigh = InstallSources(nodes.Get(0), InetSocketAddress(if12.GetAddress(1), portHigh),
+                                                     DataRate("4Mbps"), flows, Seconds(14.0), Seconds(30.0), jitter);
 
     PacketSinkHelper sinkHigh("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), portHigh));
     ApplicationContainer serverHigh = sinkHigh.Install(nodes.Get(2));
@@ -100,14 +163,18 @@ int main(int argc, char* argv[]) {
     serverHigh.Stop(Seconds(150.0));
 
     // Trace packet transmissions and receptions
-    clientLow.Get(0)->TraceConnectWithoutContext("Tx", MakeCallback(&PacketSentCallback));
-    clientHigh.Get(0)->TraceConnectWithoutContext("Tx", MakeCallback(&PacketSentCallback));
+    for (uint32_t i = 0; i < flows; ++i) {
+        clientLow.Get(i)->TraceConnectWithoutContext("Tx", MakeCallback(&PacketSentCallback));
+        clientHigh.Get(i)->TraceConnectWithoutContext("Tx", MakeCallback(&PacketSentCallback));
+    }
     serverLow.Get(0)->TraceConnectWithoutContext("Rx", MakeCallback(&PacketReceivedCallback));
     serverHigh.Get(0)->TraceConnectWithoutContext("Rx", MakeCallback(&PacketReceivedCallback));
 
     // Enable PCAP tracing
-    p2p.EnablePcap("prespq", dev01.Get(0));
-    p2p.EnablePcap("postspq", dev12.Get(1));
+    if (pcap) {
+        p2p.EnablePcap("prespq", dev01.Get(0));
+        p2p.EnablePcap("postspq", dev12.Get(1));
+    }
 
     // Install FlowMonitor
     FlowMonitorHelper flowmonHelper;
@@ -116,6 +183,9 @@ int main(int argc, char* argv[]) {
     // Run simulation
     Simulator::Stop(Seconds(150.0));
     Simulator::Run();
+
+    // Report per-port and per-queue metrics
+    PrintRunMetrics(monitor, DynamicCast<Ipv4FlowClassifier>(flowmonHelper.GetClassifier()), spq);
     Simulator::Destroy();
 
     return 0;
@@ -0,0 +1,133 @@
+#include "timer-wheel.h"
+#include <algorithm>
+
+namespace ns3 {
+
+TimerWheel::TimerWheel() : m_current(0), m_pending(0) {
+    std::fill(m_occupied, m_occupied + LEVELS, 0);
+}
+
+/**
+ * @brief Arms the timer of an id, replacing the pending one if any.
+ *
+ * @param id The id the timer belongs to.
+ * @param tick Tick at which the timer expires; past ticks expire at the next Advance().
+ */
+void TimerWheel::Schedule(uint32_t id, uint64_t tick) {
+    if (id >= m_deadline.size()) {
+        m_deadline.resize(id + 1, NO_TICK);
+    }
+    if (m_deadline[id] == NO_TICK) {
+        m_pending++;
+    }
+    tick = std::max(tick, m_current);
+    m_deadline[id] = tick;
+    Place({tick, id});
+}
+
+/**
+ * @brief Disarms the timer of an id. Its entry stays in the wheel and is skipped when reached.
+ */
+void TimerWheel::Cancel(uint32_t id) {
+    if (id < m_deadline.size() && m_deadline[id] != NO_TICK) {
+        m_deadline[id] = NO_TICK;
+        m_pending--;
+    }
+}
+
+/**
+ * @brief Processes every tick up to and including the given one.
+ *
+ * @param tick The last tick to process.
+ * @param expired Receives the ids whose timer expired, in expiry order.
+ */
+void TimerWheel::Advance(uint64_t tick, std::vector<uint32_t>& expired) {
+    while (m_current <= tick) {
+        uint32_t index = m_current & (SLOTS - 1);
+        if (index == 0) {
+            for (uint32_t level = 1; level < LEVELS && Cascade(level) == 0; ++level) {
+            }
+        }
+        if (m_occupied[0] & (1ULL << index)) {
+            std::vector<Entry> due;
+            due.swap(m_slots[0][index]);
+            m_occupied[0] &= ~(1ULL << index);
+            for (const Entry& entry : due) {
+                if (m_deadline[entry.id] != entry.expiry) {
+                    continue;
+                }
+                if (entry.expiry > m_current) {
+                    Place(entry);  // beyond the top level's reach when scheduled
+                    continue;
+                }
+                m_deadline[entry.id] = NO_TICK;
+                m_pending--;
+                expired.push_back(entry.id);
+            }
+        }
+        // Skip to the next occupied slot of this turn, or to the wrap-around that cascades.
+        uint64_t later = index + 1 < SLOTS ? m_occupied[0] & (~0ULL << (index + 1)) : 0;
+        uint64_t next = m_current - index + (later ? __builtin_ctzll(later) : SLOTS);
+        m_current = std::min(next, tick + 1);
+    }
+}
+
+/**
+ * @brief Returns the next tick Advance() has work at, or NO_TICK if no timer is pending.
+ *
+ * This is either the next occupied level-0 slot or, if there is none in the current turn,
+ * the wrap-around at which the higher levels cascade.
+ */
+uint64_t TimerWheel::GetNextTick() const {
+    if (m_pending == 0) {
+        return NO_TICK;
+    }
+    uint32_t index = m_current & (SLOTS - 1);
+    uint64_t later = m_occupied[0] & (~0ULL << index);
+    return m_current - index + (later ? __builtin_ctzll(later) : SLOTS);
+}
+
+uint64_t TimerWheel::GetCurrentTick() const {
+    return m_current;
+}
+
+uint32_t TimerWheel::GetPendingCount() const {
+    return m_pending;
+}
+
+/**
+ * @brief Puts an entry in the lowest level whose range, counted from the current tick, covers it.
+ */
+void TimerWheel::Place(const Entry& entry) {
+    uint64_t delta = entry.expiry - m_current;
+    uint32_t level = 0;
+    while (level + 1 < LEVELS && delta >= (1ULL << (BITS * (level + 1)))) {
+        level++;
+    }
+    uint64_t reach = m_current + std::min<uint64_t>(delta, (1ULL << (BITS * LEVELS)) - 1);
+    uint32_t slot = (reach >> (BITS * level)) & (SLOTS - 1);
+    m_slots[level][slot].push_back(entry);
+    m_occupied[level] |= 1ULL << slot;
+}
+
+/**
+ * @brief Moves the entries of the current slot of a level down the wheel.
+ *
+ * @return The index of the slot, so the caller cascades the next level too when it is 0.
+ */
+uint32_t TimerWheel::Cascade(uint32_t level) {
+    uint32_t index = (m_current >> (BITS * level)) & (SLOTS - 1);
+    if (m_occupied[level] & (1ULL << index)) {
+        std::vector<Entry> entries;
+        entries.swap(m_slots[level][index]);
+        m_occupied[level] &= ~(1ULL << index);
+        for (const Entry& entry : entries) {
+            if (m_deadline[entry.id] == entry.expiry) {
+                Place(entry);
+            }
+        }
+    }
+    return index;
+}
+
+} // namespace ns3
@@ -0,0 +1,53 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * @brief Hierarchical timer wheel keyed by small integer ids, in ticks.
+ *
+ * LEVELS wheels of SLOTS slots each cover SLOTS^LEVELS ticks ahead; a timer goes to the
+ * lowest level whose range reaches its expiry and cascades one level down each time the
+ * wheel below wraps around. Scheduling and cancelling are O(1), and Advance() skips
+ * empty level-0 slots with the occupancy bitmap, so the owner only needs to wake up at
+ * GetNextTick(). Each id has at most one pending timer; rescheduling replaces it.
+ */
+class TimerWheel {
+public:
+    static constexpr uint64_t NO_TICK = UINT64_MAX;
+
+    TimerWheel();
+
+    void Schedule(uint32_t id, uint64_t tick);
+    void Cancel(uint32_t id);
+    void Advance(uint64_t tick, std::vector<uint32_t>& expired);
+    uint64_t GetNextTick() const;
+    uint64_t GetCurrentTick() const;
+    uint32_t GetPendingCount() const;
+
+private:
+    static const uint32_t BITS = 6;
+    static const uint32_t SLOTS = 1 << BITS;
+    static const uint32_t LEVELS = 4;
+
+    struct Entry {
+        uint64_t expiry;
+        uint32_t id;
+    };
+
+    void Place(const Entry& entry);
+    uint32_t Cascade(uint32_t level);
+
+    std::vector<Entry> m_slots[LEVELS][SLOTS];
+    uint64_t m_occupied[LEVELS];      // bit i set if slot i of the level holds entries
+    uint64_t m_current;               // next tick to process
+    std::vector<uint64_t> m_deadline; // pending expiry per id; entries with another expiry are stale
+    uint32_t m_pending;
+};
+
+} // namespace ns3
+
+#endif /* TIMER_WHEEL_H */
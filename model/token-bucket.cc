@@ -0,0 +1,94 @@
+#include "token-bucket.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+TokenBucket::TokenBucket() : m_rate(0), m_burst(0), m_tokens(0) {
+}
+
+/**
+ * @brief Sets the rate and burst size and fills the bucket.
+ *
+ * @param rate Rate at which tokens accrue; zero disables the bucket.
+ * @param burst Bucket depth, in bytes. Packets larger than the burst never conform.
+ */
+void TokenBucket::Configure(DataRate rate, uint32_t burst) {
+    m_rate = rate;
+    m_burst = burst;
+    m_tokens = burst;
+    m_lastUpdate = Seconds(0);
+}
+
+bool TokenBucket::IsEnabled() const {
+    return m_rate.GetBitRate() > 0;
+}
+
+DataRate TokenBucket::GetRate() const {
+    return m_rate;
+}
+
+uint32_t TokenBucket::GetBurst() const {
+    return m_burst;
+}
+
+/**
+ * @brief Checks whether the bucket holds enough tokens for a packet.
+ *
+ * @param bytes Size of the packet, in bytes.
+ * @param now The current simulation time.
+ * @return True if the packet is within the profile.
+ */
+bool TokenBucket::Conforms(uint32_t bytes, Time now) {
+    if (!IsEnabled()) {
+        return true;
+    }
+    Refill(now);
+    return m_tokens >= bytes;
+}
+
+/**
+ * @brief Takes the tokens for a packet out of the bucket.
+ *
+ * The bucket may go negative if the packet did not conform, delaying later packets.
+ *
+ * @param bytes Size of the packet, in bytes.
+ * @param now The current simulation time.
+ */
+void TokenBucket::Consume(uint32_t bytes, Time now) {
+    if (!IsEnabled()) {
+        return;
+    }
+    Refill(now);
+    m_tokens -= bytes;
+}
+
+/**
+ * @brief Returns the earliest time at which a packet will conform.
+ *
+ * @param bytes Size of the packet, in bytes; capped at the burst size.
+ * @param now The current simulation time.
+ * @return now if the packet conforms already, else the time the missing tokens accrue.
+ */
+Time TokenBucket::GetConformTime(uint32_t bytes, Time now) {
+    if (!IsEnabled()) {
+        return now;
+    }
+    Refill(now);
+    double missing = std::min<double>(bytes, m_burst) - m_tokens;
+    if (missing <= 0) {
+        return now;
+    }
+    double seconds = missing * 8 / m_rate.GetBitRate();
+    return now + NanoSeconds(static_cast<uint64_t>(std::ceil(seconds * 1e9)));
+}
+
+void TokenBucket::Refill(Time now) {
+    if (now > m_lastUpdate) {
+        double elapsed = (now - m_lastUpdate).GetSeconds();
+        m_tokens = std::min<double>(m_burst, m_tokens + elapsed * m_rate.GetBitRate() / 8);
+        m_lastUpdate = now;
+    }
+}
+
+} // namespace ns3
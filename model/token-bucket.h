@@ -0,0 +1,41 @@
+#ifndef TOKEN_BUCKET_H
+#define TOKEN_BUCKET_H
+
+#include "ns3/data-rate.h"
+#include "ns3/nstime.h"
+#include <cstdint>
+
+namespace ns3 {
+
+/**
+ * @brief Token bucket of a given rate and burst size, in bytes.
+ *
+ * Tokens accrue at the configured rate up to the burst size and are refilled lazily,
+ * from the time elapsed since the last update, whenever the bucket is queried. A
+ * bucket with a zero rate is disabled and conforms to everything.
+ */
+class TokenBucket {
+public:
+    TokenBucket();
+
+    void Configure(DataRate rate, uint32_t burst);
+    bool IsEnabled() const;
+    DataRate GetRate() const;
+    uint32_t GetBurst() const;
+
+    bool Conforms(uint32_t bytes, Time now);
+    void Consume(uint32_t bytes, Time now);
+    Time GetConformTime(uint32_t bytes, Time now);
+
+private:
+    void Refill(Time now);
+
+    DataRate m_rate;
+    uint32_t m_burst;
+    double m_tokens;   // bytes available at m_lastUpdate; negative after a forced Consume()
+    Time m_lastUpdate;
+};
+
+} // namespace ns3
+
+#endif /* TOKEN_BUCKET_H */
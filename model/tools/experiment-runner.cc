@@ -0,0 +1,309 @@
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <spawn.h>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+extern char** environ;
+
+/**
+ * Runs a parameter sweep of spq-simulation or drr-simulation in parallel and aggregates
+ * the metrics of every run.
+ *
+ * Usage: experiment-runner <sweep-file> [csv-file]. The sweep file holds one setting
+ * per line ('#' starts a comment):
+ *
+ *     program <path>            scenario binary, e.g. build/.../ns3.44-drr-simulation-default
+ *     config <file>...          scheduler config files
+ *     rate <rate>...            bottleneck data rates, e.g. 1Mbps 2Mbps
+ *     flows <count>...          on-off sources per application
+ *     runs <first> <last>       RNG runs of every point
+ *     jobs <count>              concurrent runs; 0 (the default) uses every core
+ *     args <argument>...        extra arguments passed to every run
+ *     output <directory>        where run logs are kept (default "sweep-output")
+ *
+ * Every combination of config, rate and flows is a point, and every point is run once
+ * per RNG run, each run as a separate process with its output in its own log file. The
+ * "metric <name> <value>" lines the scenarios print are averaged per point, with a 95%
+ * Student t confidence interval over the runs, and written as CSV to the given file or
+ * to stdout.
+ */
+
+namespace {
+
+struct Sweep {
+    std::string program;
+    std::vector<std::string> configs;
+    std::vector<std::string> rates{"1Mbps"};
+    std::vector<std::string> flows{"1"};
+    uint32_t firstRun = 1;
+    uint32_t lastRun = 1;
+    uint32_t jobs = 0;
+    std::vector<std::string> args;
+    std::string output = "sweep-output";
+};
+
+struct Point {
+    std::string config;
+    std::string rate;
+    std::string flows;
+    std::map<std::string, std::vector<double>> metrics;
+    uint32_t failures = 0;
+};
+
+struct Run {
+    uint32_t point;
+    uint32_t rngRun;
+    std::string log;
+};
+
+std::vector<std::string> ReadWords(std::istream& in) {
+    std::vector<std::string> words;
+    std::string word;
+    while (in >> word) {
+        words.push_back(word);
+    }
+    return words;
+}
+
+/**
+ * @brief Reads a sweep file.
+ *
+ * @return True if the file could be read and names a program and at least one config.
+ */
+bool ReadSweep(const std::string& filename, Sweep& sweep) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open sweep file: " << filename << std::endl;
+        return false;
+    }
+    std::string line;
+    uint32_t number = 0;
+    while (std::getline(file, line)) {
+        number++;
+        std::istringstream iss(line.substr(0, line.find('#')));
+        std::string token;
+        if (!(iss >> token)) {
+            continue;
+        }
+        bool ok = true;
+        if (token == "program") {
+            ok = static_cast<bool>(iss >> sweep.program);
+        } else if (token == "config") {
+            sweep.configs = ReadWords(iss);
+        } else if (token == "rate") {
+            sweep.rates = ReadWords(iss);
+        } else if (token == "flows") {
+            sweep.flows = ReadWords(iss);
+        } else if (token == "runs") {
+            ok = (iss >> sweep.firstRun >> sweep.lastRun) && sweep.firstRun <= sweep.lastRun;
+        } else if (token == "jobs") {
+            ok = static_cast<bool>(iss >> sweep.jobs);
+        } else if (token == "args") {
+            sweep.args = ReadWords(iss);
+        } else if (token == "output") {
+            ok = static_cast<bool>(iss >> sweep.output);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << filename << ":" << number << ": invalid line: " << line << std::endl;
+            return false;
+        }
+    }
+    if (sweep.program.empty() || sweep.configs.empty() || sweep.rates.empty() || sweep.flows.empty()) {
+        std::cerr << filename << ": a program and at least one config, rate and flow count are required"
+                  << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Starts one run of the scenario with its output redirected to the run's log file.
+ *
+ * @return The process id, or -1 if the process could not be started.
+ */
+pid_t Spawn(const Sweep& sweep, const Point& point, const Run& run) {
+    std::vector<std::string> args = {sweep.program,
+                                     point.config,
+                                     "--bottleneckRate=" + point.rate,
+                                     "--flows=" + point.flows,
+                                     "--RngRun=" + std::to_string(run.rngRun),
+                                     "--pcap=false"};
+    args.insert(args.end(), sweep.args.begin(), sweep.args.end());
+    std::vector<char*> argv;
+    for (std::string& arg : args) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, run.log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+    pid_t pid;
+    int error = posix_spawn(&pid, sweep.program.c_str(), &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (error != 0) {
+        std::cerr << "Failed to start " << sweep.program << ": " << std::strerror(error) << std::endl;
+        return -1;
+    }
+    return pid;
+}
+
+/**
+ * @brief Adds the "metric <name> <value>" lines of a finished run's log to its point.
+ */
+void CollectMetrics(const Run& run, Point& point) {
+    std::ifstream log(run.log);
+    std::string line;
+    while (std::getline(log, line)) {
+        std::istringstream iss(line);
+        std::string token, name;
+        double value;
+        if (iss >> token >> name >> value && token == "metric") {
+            point.metrics[name].push_back(value);
+        }
+    }
+}
+
+/**
+ * @brief Returns the two-sided 95% critical value of Student's t distribution.
+ */
+double StudentT95(uint32_t degrees) {
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                   2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (degrees == 0) {
+        return 0;
+    }
+    return degrees <= 30 ? table[degrees - 1] : 1.960;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <sweep-file> [csv-file]" << std::endl;
+        return 1;
+    }
+    Sweep sweep;
+    if (!ReadSweep(argv[1], sweep)) {
+        return 1;
+    }
+    if (mkdir(sweep.output.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "Failed to create output directory " << sweep.output << ": " << std::strerror(errno)
+                  << std::endl;
+        return 1;
+    }
+    uint32_t jobs = sweep.jobs ? sweep.jobs : std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<Point> points;
+    std::vector<Run> runs;
+    for (const std::string& config : sweep.configs) {
+        for (const std::string& rate : sweep.rates) {
+            for (const std::string& flows : sweep.flows) {
+                uint32_t index = points.size();
+                points.push_back({config, rate, flows});
+                for (uint32_t rngRun = sweep.firstRun; rngRun <= sweep.lastRun; ++rngRun) {
+                    runs.push_back({index, rngRun,
+                                    sweep.output + "/point" + std::to_string(index) + "-run"
+                                        + std::to_string(rngRun) + ".log"});
+                }
+            }
+        }
+    }
+    std::cerr << "Running " << runs.size() << " runs of " << points.size() << " points on " << jobs
+              << " cores" << std::endl;
+
+    std::map<pid_t, uint32_t> running;
+    size_t next = 0;
+    size_t finished = 0;
+    while (finished < runs.size()) {
+        while (next < runs.size() && running.size() < jobs) {
+            pid_t pid = Spawn(sweep, points[runs[next].point], runs[next]);
+            if (pid < 0) {
+                // The program cannot be started, so neither can the remaining runs.
+                for (; next < runs.size(); ++next) {
+                    points[runs[next].point].failures++;
+                    finished++;
+                }
+                break;
+            }
+            running[pid] = next++;
+        }
+        if (running.empty()) {
+            continue;
+        }
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "waitpid failed: " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        auto it = running.find(pid);
+        if (it == running.end()) {
+            continue;
+        }
+        const Run& run = runs[it->second];
+        running.erase(it);
+        finished++;
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+            CollectMetrics(run, points[run.point]);
+        } else {
+            points[run.point].failures++;
+            std::cerr << "Run failed, see " << run.log << std::endl;
+        }
+        std::cerr << "\r" << finished << "/" << runs.size() << " runs done" << std::flush;
+    }
+    std::cerr << std::endl;
+
+    std::ofstream file;
+    if (argc > 2) {
+        file.open(argv[2]);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open output file: " << argv[2] << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = argc > 2 ? file : std::cout;
+
+    out << "config,rate,flows,metric,runs,mean,stddev,ci95_low,ci95_high\n" << std::setprecision(6);
+    bool failed = false;
+    for (const Point& point : points) {
+        failed = failed || point.failures > 0;
+        for (const auto& [name, values] : point.metrics) {
+            double mean = 0;
+            for (double value : values) {
+                mean += value;
+            }
+            mean /= values.size();
+            double variance = 0;
+            for (double value : values) {
+                variance += (value - mean) * (value - mean);
+            }
+            double stddev = values.size() > 1 ? std::sqrt(variance / (values.size() - 1)) : 0;
+            double half = StudentT95(values.size() - 1) * stddev / std::sqrt(values.size());
+            out << point.config << ',' << point.rate << ',' << point.flows << ',' << name << ','
+                << values.size() << ',' << mean << ',' << stddev << ',' << mean - half << ',' << mean + half
+                << '\n';
+        }
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,150 @@
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "drr.h"
+#include "spq.h"
+#include "wfq.h"
+#include "hierarchical-scheduler.h"
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+using namespace ns3;
+
+/**
+ * Measures the per-packet cost of DiffServ::Enqueue and DiffServ::Dequeue for DRR, SPQ,
+ * WFQ and a two-level HierarchicalScheduler as the number of classes grows: every class
+ * is filled with the same number of packets, then the scheduler is drained. Classes get
+ * one dst_port filter each, mixed weights and distinct priorities.
+ */
+
+namespace {
+
+const uint32_t PACKET_SIZE = 1024;
+
+/**
+ * @brief Builds a PPP-framed IPv4/UDP packet to the given destination port.
+ */
+Ptr<Packet> BuildPacket(uint16_t dstPort) {
+    uint8_t buf[PACKET_SIZE] = {};
+    buf[0] = 0x00;
+    buf[1] = 0x21;            // PPP: IPv4
+    uint8_t* ip = buf + 2;
+    ip[0] = 0x45;             // version 4, 20-byte header
+    ip[9] = 17;               // UDP
+    ip[12] = 10;              // 10.1.1.1 -> 10.1.2.2
+    ip[13] = ip[14] = ip[15] = 1;
+    ip[16] = 10;
+    ip[17] = 1;
+    ip[18] = ip[19] = 2;
+    uint8_t* udp = ip + 20;
+    udp[0] = 0xc0;            // source port 49152
+    udp[2] = dstPort >> 8;
+    udp[3] = dstPort & 0xff;
+    return Create<Packet>(buf, PACKET_SIZE);
+}
+
+Ptr<TrafficClass> BuildClass(uint32_t q) {
+    Ptr<TrafficClass> tc = CreateObject<TrafficClass>();
+    tc->SetWeight(100 * (1 + q % 4));
+    tc->SetPriorityLevel(q);
+    tc->SetMaxPackets(1u << 20);
+    Filter* filter = new Filter();
+    filter->AddElement(new DstPortNumber(10000 + q));
+    tc->AddFilter(filter);
+    return tc;
+}
+
+template <typename Scheduler>
+Ptr<Scheduler> BuildScheduler(uint32_t classes) {
+    Ptr<Scheduler> scheduler = CreateObject<Scheduler>();
+    scheduler->SetMaxSize(QueueSize(QueueSizeUnit::PACKETS, UINT32_MAX));
+    for (uint32_t q = 0; q < classes; ++q) {
+        scheduler->AddQueue(BuildClass(q));
+    }
+    scheduler->CompileClassifier();
+    return scheduler;
+}
+
+/**
+ * @brief Builds a WFQ root over tenants of eight classes each, served by DRR.
+ */
+template <>
+Ptr<HierarchicalScheduler> BuildScheduler<HierarchicalScheduler>(uint32_t classes) {
+    Ptr<HierarchicalScheduler> scheduler = CreateObject<HierarchicalScheduler>();
+    scheduler->SetMaxSize(QueueSize(QueueSizeUnit::PACKETS, UINT32_MAX));
+    uint32_t root = scheduler->AddNode(HierarchicalScheduler::FAIR_QUEUEING, HierarchicalScheduler::NO_PARENT);
+    uint32_t tenant = root;
+    for (uint32_t q = 0; q < classes; ++q) {
+        if (q % 8 == 0) {
+            tenant = scheduler->AddNode(HierarchicalScheduler::DEFICIT_ROUND_ROBIN, root, 1 + q / 8 % 4);
+        }
+        scheduler->AttachQueue(BuildClass(q), tenant);
+    }
+    scheduler->CompileClassifier();
+    return scheduler;
+}
+
+/**
+ * @brief Fills and drains the scheduler repeat times.
+ *
+ * @return Nanoseconds per enqueued and per dequeued packet.
+ */
+template <typename Scheduler>
+std::pair<double, double> Measure(uint32_t classes, uint32_t depth, uint32_t repeat) {
+    Ptr<Scheduler> scheduler = BuildScheduler<Scheduler>(classes);
+    std::vector<Ptr<Packet>> packets;
+    for (uint32_t q = 0; q < classes; ++q) {
+        packets.push_back(BuildPacket(10000 + q));
+    }
+    std::chrono::duration<double, std::nano> enqueue(0), dequeue(0);
+    uint64_t count = 0;
+    for (uint32_t r = 0; r < repeat; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t d = 0; d < depth; ++d) {
+            for (uint32_t q = 0; q < classes; ++q) {
+                scheduler->Enqueue(packets[q]);
+            }
+        }
+        auto filled = std::chrono::steady_clock::now();
+        uint64_t drained = 0;
+        while (scheduler->Dequeue()) {
+            ++drained;
+        }
+        auto end = std::chrono::steady_clock::now();
+        enqueue += filled - start;
+        dequeue += end - filled;
+        count += drained;
+    }
+    return {enqueue.count() / count, dequeue.count() / count};
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    uint32_t depth = 16;
+    uint32_t repeat = 5;
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("depth", "Packets queued per class before draining", depth);
+    cmd.AddValue("repeat", "Number of fill/drain cycles per measurement", repeat);
+    cmd.Parse(argc, argv);
+
+    const uint32_t classCounts[] = {8, 64, 512, 4096};
+
+    std::cout << std::setw(8) << "classes"
+              << std::setw(12) << "DRR enq" << std::setw(12) << "DRR deq"
+              << std::setw(12) << "SPQ enq" << std::setw(12) << "SPQ deq"
+              << std::setw(12) << "WFQ enq" << std::setw(12) << "WFQ deq"
+              << std::setw(12) << "Tree enq" << std::setw(12) << "Tree deq" << "   (ns/packet)\n";
+    for (uint32_t classes : classCounts) {
+        std::pair<double, double> drr = Measure<DRR>(classes, depth, repeat);
+        std::pair<double, double> spq = Measure<SPQ>(classes, depth, repeat);
+        std::pair<double, double> wfq = Measure<WFQ>(classes, depth, repeat);
+        std::pair<double, double> tree = Measure<HierarchicalScheduler>(classes, depth, repeat);
+        std::cout << std::setw(8) << classes << std::fixed << std::setprecision(1)
+                  << std::setw(12) << drr.first << std::setw(12) << drr.second
+                  << std::setw(12) << spq.first << std::setw(12) << spq.second
+                  << std::setw(12) << wfq.first << std::setw(12) << wfq.second
+                  << std::setw(12) << tree.first << std::setw(12) << tree.second << "\n";
+    }
+    return 0;
+}
@@ -1,8 +1,13 @@
 #include "traffic-class.h"
+#include "ns3/log.h"
 #include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "packet-marker.h"
 
 namespace ns3 {
 
+NS_LOG_COMPONENT_DEFINE("TrafficClass");
+
 NS_OBJECT_ENSURE_REGISTERED(TrafficClass);
 
 /**
@@ -16,68 +21,175 @@ TypeId TrafficClass::GetTypeId(void) {
     static TypeId tid = TypeId("ns3::TrafficClass")
         .SetParent<Object>()
         .SetGroupName("Network")
-        .AddConstructor<TrafficClass>();
+        .AddConstructor<TrafficClass>()
+        .AddTraceSource("Sojourn",
+                        "Time each dequeued packet spent in the queue.",
+                        MakeTraceSourceAccessor(&TrafficClass::sojournTrace),
+                        "ns3::Time::TracedCallback")
+        .AddTraceSource("PacketsInQueue",
+                        "Number of packets in the queue.",
+                        MakeTraceSourceAccessor(&TrafficClass::packets),
+                        "ns3::TracedValueCallback::Uint32")
+        .AddTraceSource("BytesInQueue",
+                        "Number of bytes in the queue.",
+                        MakeTraceSourceAccessor(&TrafficClass::bytes),
+                        "ns3::TracedValueCallback::Uint64");
     return tid;
 }
 
 TrafficClass::TrafficClass()
-    : packets(0), maxPackets(1000), weight(0), priority_level(0), isDefault(false) {
+    : packets(0), bytes(0), maxPackets(1000), weight(0), priority_level(0), isDefault(false),
+      policerAction(DROP), remarkDscp(0), aqm(nullptr), aqmDrops(0), aqmMarks(0),
+      lastOccupancyChange(Simulator::Now()) {
+    m_queue.Reserve(maxPackets);
+    setDscp = MakeCallback(&PacketMarker::SetDscp);
+    setEcnCe = MakeCallback(&PacketMarker::SetEcnCe);
 }
 
 /**
  * @brief Destructor for TrafficClass.
  *
- * Frees memory allocated for all filters and clears the filters vector.
+ * Frees memory allocated for all filters and the AQM policy, and clears the filters vector.
  */
 TrafficClass::~TrafficClass() {
     for (Filter* filter : filters) {
         delete filter;
     }
     filters.clear();
+    delete aqm;
 }
 
 /**
  * @brief Checks if a packet matches any filter in the traffic class.
  *
- * If no filters are present, the packet is accepted. Otherwise, the packet is evaluated
- * against each filter, and accepted if any filter matches. Logs the outcome.
+ * If no filters are present, the packet is accepted. Otherwise, the packet's flow key is
+ * evaluated against each filter, and accepted if any filter matches. Logs the outcome.
  *
- * @param p Pointer to the packet to be evaluated.
+ * @param key Header fields extracted from the packet being evaluated.
  * @return True if the packet matches any filter or no filters exist, false otherwise.
  */
-bool TrafficClass::match(Ptr<Packet> p) {
+bool TrafficClass::match(const FlowKey& key) {
     if (filters.empty()) {
-        std::cout << "TrafficClass::match: No filters, packet accepted" << std::endl;
+        NS_LOG_LOGIC("No filters, packet accepted");
         return true;
     }
 
     for (Filter* filter : filters) {
-        if (filter->match(p)) {
-            std::cout << "TrafficClass::match: Packet accepted by filter" << std::endl;
+        if (filter->match(key)) {
+            NS_LOG_LOGIC("Packet accepted by filter");
             return true;
         }
     }
-    std::cout << "TrafficClass::match: Packet rejected by filter" << std::endl;
+    NS_LOG_LOGIC("Packet rejected by filter");
     return false;
 }
 
+/**
+ * @brief Enqueues a packet whose flow and class are not known to the caller.
+ *
+ * @param p Pointer to the packet to be enqueued.
+ * @return True if the packet was successfully enqueued.
+ */
+bool TrafficClass::Enqueue(Ptr<Packet> p) {
+    PacketDescriptor descriptor;
+    descriptor.size = p->GetSize();
+    return Enqueue(p, descriptor);
+}
+
 /**
  * @brief Enqueues a packet into the traffic class queue.
  *
- * Checks if the queue has reached its maximum capacity. If not, enqueues the packet
- * and increments the packet count. Logs the outcome.
+ * Runs the admission checks of Admit() and, if the packet passes, queues it with Push().
  *
  * @param p Pointer to the packet to be enqueued.
- * @return True if the packet was successfully enqueued, false if the queue is full.
+ * @param descriptor The packet's size, flow hash and class index.
+ * @return True if the packet was successfully enqueued, false if the queue is full or the
+ *         policer or AQM dropped the packet.
  */
-bool TrafficClass::Enqueue(Ptr<Packet> p) {
+bool TrafficClass::Enqueue(Ptr<Packet> p, PacketDescriptor descriptor) {
+    if (!Admit(p, descriptor.size)) {
+        return false;
+    }
+    Push(p, descriptor);
+    return true;
+}
+
+/**
+ * @brief Decides whether an arriving packet may be queued.
+ *
+ * Checks if the queue has reached its maximum capacity. If not, the packet is checked
+ * against the policer, if any: packets within the profile consume tokens, packets that
+ * exceed it are dropped or remarked. An enqueue-time AQM policy (RED, PIE) may then drop
+ * or ECN-mark it. An admitted packet must be passed to Push() before the class is used
+ * again.
+ *
+ * @param p Pointer to the arriving packet.
+ * @param size Size of the packet, in bytes.
+ * @return True if the packet may be queued, false if the queue is full or the policer or
+ *         AQM dropped the packet.
+ */
+bool TrafficClass::Admit(Ptr<Packet> p, uint32_t size) {
     if (packets >= maxPackets) {
-        std::cout << "TrafficClass::Enqueue: Queue full, packet dropped" << std::endl;
+        NS_LOG_DEBUG("Queue full, packet dropped");
         return false;
     }
-    m_queue.push(p);
+    Time now = Simulator::Now();
+    if (policer.IsEnabled()) {
+        if (policer.Conforms(size, now)) {
+            policer.Consume(size, now);
+        } else if (policerAction == DROP) {
+            NS_LOG_DEBUG("Packet exceeds policer profile, dropped");
+            return false;
+        } else {
+            setDscp(p, remarkDscp);
+            NS_LOG_LOGIC("Packet exceeds policer profile, remarked with DSCP " << +remarkDscp);
+        }
+    }
+    if (aqm && !Signal(aqm->OnEnqueue(packets, bytes, now), p)) {
+        NS_LOG_DEBUG(aqm->GetName() << " dropped packet at enqueue");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Queues an admitted packet with its descriptor, stamped with the arrival time,
+ * and increments the packet count. Logs the outcome.
+ *
+ * @param p Pointer to the packet.
+ * @param descriptor The packet's size, flow hash and class index.
+ */
+void TrafficClass::Push(Ptr<Packet> p, PacketDescriptor descriptor) {
+    Time now = Simulator::Now();
+    descriptor.arrival = now;
+    UpdateOccupancy(now);
+    m_queue.Push({p, descriptor});
     packets++;
-    std::cout << "TrafficClass::Enqueue: Packet enqueued, current size=" << packets << std::endl;
+    bytes += descriptor.size;
+    NS_LOG_LOGIC("Packet enqueued, current size=" << packets << " packets, " << bytes << " bytes");
+}
+
+/**
+ * @brief Queues a packet moved over from another class, e.g. by DiffServ::Reload().
+ *
+ * The packet was admitted once already, so only the class's limit applies: the policer
+ * and AQM do not see it again, and it keeps its arrival time, so its sojourn time still
+ * counts from its original enqueue.
+ *
+ * @param p Pointer to the packet.
+ * @param descriptor The packet's descriptor, with its arrival time.
+ * @return True if the packet was queued, false if the queue is full.
+ */
+bool TrafficClass::Adopt(Ptr<Packet> p, const PacketDescriptor& descriptor) {
+    if (packets >= maxPackets) {
+        NS_LOG_DEBUG("Queue full, moved packet dropped");
+        return false;
+    }
+    UpdateOccupancy(Simulator::Now());
+    m_queue.Push({p, descriptor});
+    packets++;
+    bytes += descriptor.size;
+    NS_LOG_LOGIC("Packet moved in, current size=" << packets << " packets, " << bytes << " bytes");
     return true;
 }
 
@@ -85,66 +197,119 @@ bool TrafficClass::Enqueue(Ptr<Packet> p) {
  * @brief Dequeues a packet from the traffic class queue.
  *
  * Removes and returns the front packet from the queue, if available, and decrements
- * the packet count. Logs the outcome.
+ * the packet count. A dequeue-time AQM policy (CoDel) judges each head packet by its
+ * sojourn time and may drop it, in which case the drop callback is told and the next
+ * one is tried, or ECN-mark it.
+ * The returned packet's sojourn time is recorded and traced, and its size charged to
+ * the shaper, if any. Logs the outcome.
  *
- * @return Pointer to the dequeued packet, or nullptr if the queue is empty.
+ * @param descriptor If not null, receives the descriptor of the returned packet.
+ * @return Pointer to the dequeued packet, or nullptr if the queue is empty or the AQM
+ *         dropped every queued packet.
  */
-Ptr<Packet> TrafficClass::Dequeue() {
-    if (m_queue.empty()) {
-        std::cout << "TrafficClass::Dequeue: Queue empty" << std::endl;
-        return nullptr;
+Ptr<Packet> TrafficClass::Dequeue(PacketDescriptor* descriptor) {
+    Time now = Simulator::Now();
+    if (!m_queue.IsEmpty()) {
+        UpdateOccupancy(now);
     }
-    Ptr<Packet> p = m_queue.front();
-    m_queue.pop();
-    packets--;
-    std::cout << "TrafficClass::Dequeue: Packet dequeued, remaining size=" << packets << std::endl;
-    return p;
+    while (!m_queue.IsEmpty()) {
+        Item item = m_queue.Pop();
+        packets--;
+        bytes -= item.descriptor.size;
+        Time sojourn = now - item.descriptor.arrival;
+        if (aqm && !Signal(aqm->OnDequeue(sojourn, bytes, now), item.packet)) {
+            NS_LOG_DEBUG(aqm->GetName() << " dropped packet at dequeue, sojourn=" << sojourn.GetSeconds() << "s");
+            if (!dropped.IsNull()) {
+                dropped(item.packet, item.descriptor);
+            }
+            continue;
+        }
+        sojournHistogram.Record(sojourn.GetNanoSeconds());
+        sojournTrace(sojourn);
+        shaper.Consume(item.descriptor.size, now);
+        if (descriptor) {
+            *descriptor = item.descriptor;
+        }
+        NS_LOG_LOGIC("Packet dequeued, remaining size=" << packets);
+        return item.packet;
+    }
+    NS_LOG_LOGIC("Queue empty");
+    return nullptr;
 }
 
-Ptr<Packet> TrafficClass::Remove() {
-    if (m_queue.empty()) {
-        std::cout << "TrafficClass::Remove: Queue empty" << std::endl;
+/**
+ * @brief Removes the front packet, bypassing the AQM policy and the shaper.
+ *
+ * @param descriptor If not null, receives the descriptor of the removed packet.
+ * @return Pointer to the removed packet, or nullptr if the queue is empty.
+ */
+Ptr<Packet> TrafficClass::Remove(PacketDescriptor* descriptor) {
+    if (m_queue.IsEmpty()) {
+        NS_LOG_LOGIC("Queue empty");
         return nullptr;
     }
-    Ptr<Packet> p = m_queue.front();
-    m_queue.pop();
+    UpdateOccupancy(Simulator::Now());
+    Item item = m_queue.Pop();
     packets--;
-    std::cout << "TrafficClass::Remove: Packet removed, remaining size=" << packets << std::endl;
-    return p;
+    bytes -= item.descriptor.size;
+    if (descriptor) {
+        *descriptor = item.descriptor;
+    }
+    NS_LOG_LOGIC("Packet removed, remaining size=" << packets);
+    return item.packet;
 }
 
 Ptr<const Packet> TrafficClass::Peek() {
-    if (m_queue.empty()) {
-        std::cout << "TrafficClass::Peek: Queue empty" << std::endl;
+    if (m_queue.IsEmpty()) {
+        NS_LOG_LOGIC("Queue empty");
         return nullptr;
     }
-    Ptr<const Packet> p = m_queue.front();
-    std::cout << "TrafficClass::Peek: Peeked packet, size=" << packets << std::endl;
+    Ptr<const Packet> p = m_queue.Front().packet;
+    NS_LOG_LOGIC("Peeked packet, size=" << packets);
     return p;
 }
 
+/**
+ * @brief Returns the descriptor of the front packet without touching the packet itself.
+ *
+ * @return The descriptor, valid until the queue changes, or nullptr if the queue is empty.
+ */
+const PacketDescriptor* TrafficClass::PeekDescriptor() const {
+    return m_queue.IsEmpty() ? nullptr : &m_queue.Front().descriptor;
+}
+
 bool TrafficClass::IsEmpty() {
-    bool empty = m_queue.empty();
-    std::cout << "TrafficClass::IsEmpty: Queue " << (empty ? "is empty" : "is not empty") << std::endl;
+    bool empty = m_queue.IsEmpty();
+    NS_LOG_LOGIC("Queue " << (empty ? "is empty" : "is not empty"));
     return empty;
 }
 
 /**
  * @brief Sets the maximum number of packets the queue can hold.
  *
- * Updates the maximum packet capacity and logs the new value.
+ * Updates the maximum packet capacity, resizes the packet ring for it and logs the new
+ * value.
  *
  * @param mp The maximum number of packets.
  */
 void TrafficClass::SetMaxPackets(uint32_t mp) {
     maxPackets = mp;
-    std::cout << "TrafficClass::SetMaxPackets: Set maxPackets=" << maxPackets << std::endl;
+    m_queue.Reserve(maxPackets);
+    NS_LOG_INFO("Set maxPackets=" << maxPackets);
 }
 
 uint32_t TrafficClass::GetMaxPackets() {
     return maxPackets;
 }
 
+uint32_t TrafficClass::GetNPackets() const {
+    return packets;
+}
+
+uint64_t TrafficClass::GetNBytes() const {
+    return bytes;
+}
+
 /**
  * @brief Sets the weight of the traffic class.
  *
@@ -154,7 +319,7 @@ uint32_t TrafficClass::GetMaxPackets() {
  */
 void TrafficClass::SetWeight(uint32_t w) {
     weight = w;
-    std::cout << "TrafficClass::SetWeight: Set weight=" << weight << std::endl;
+    NS_LOG_INFO("Set weight=" << weight);
 }
 
 uint32_t TrafficClass::GetWeight() {
@@ -163,7 +328,7 @@ uint32_t TrafficClass::GetWeight() {
 
 void TrafficClass::SetPriorityLevel(uint32_t pl) {
     priority_level = pl;
-    std::cout << "TrafficClass::SetPriorityLevel: Set priority_level=" << priority_level << std::endl;
+    NS_LOG_INFO("Set priority_level=" << priority_level);
 }
 
 uint32_t TrafficClass::GetPriorityLevel() {
@@ -172,7 +337,7 @@ uint32_t TrafficClass::GetPriorityLevel() {
 
 void TrafficClass::SetDefault(bool d) {
     isDefault = d;
-    std::cout << "TrafficClass::SetDefault: Set isDefault=" << (isDefault ? "true" : "false") << std::endl;
+    NS_LOG_INFO("Set isDefault=" << (isDefault ? "true" : "false"));
 }
 
 bool TrafficClass::GetDefault() {
@@ -182,13 +347,211 @@ bool TrafficClass::GetDefault() {
 /**
  * @brief Adds a filter to the traffic class.
  *
- * Appends the provided filter to the list of filters and logs the updated filter count.
+ * Appends the provided filter to the list of filters, notifies the owner that the rule
+ * set changed and logs the updated filter count.
  *
  * @param f Pointer to the filter to be added.
  */
 void TrafficClass::AddFilter(Filter* f) {
     filters.push_back(f);
-    std::cout << "TrafficClass::AddFilter: Added filter, total filters=" << filters.size() << std::endl;
+    if (!filtersChanged.IsNull()) {
+        filtersChanged();
+    }
+    NS_LOG_INFO("Added filter, total filters=" << filters.size());
+}
+
+const std::vector<Filter*>& TrafficClass::GetFilters() const {
+    return filters;
+}
+
+/**
+ * @brief Registers a callback invoked whenever a filter is added to this class.
+ *
+ * DiffServ uses it to invalidate its compiled classifier.
+ *
+ * @param cb The callback to invoke.
+ */
+void TrafficClass::SetFiltersChangedCallback(Callback<void> cb) {
+    filtersChanged = cb;
+}
+
+/**
+ * @brief Registers a callback invoked for each queued packet the AQM policy drops.
+ *
+ * DiffServ uses it to release the packet's buffer and account for the drop.
+ *
+ * @param cb The callback, given the dropped packet and its descriptor.
+ */
+void TrafficClass::SetDropCallback(Callback<void, Ptr<Packet>, const PacketDescriptor&> cb) {
+    dropped = cb;
+}
+
+/**
+ * @brief Replaces the functions that rewrite the DSCP and ECN fields of queued packets.
+ *
+ * By default PacketMarker rewrites the headers of PPP-framed packets in place. Packets
+ * whose IP header is held elsewhere, as in DiffServQueueDisc, need their owner to do it.
+ *
+ * @param dscp Sets the DSCP of a packet the policer remarks; returns false if it could not.
+ * @param ecnCe Sets ECN CE on a packet the AQM marks; returns false if the packet is not
+ *              ECN-capable, in which case it is dropped instead.
+ */
+void TrafficClass::SetMarkCallbacks(Callback<bool, Ptr<Packet>, uint8_t> dscp, Callback<bool, Ptr<Packet>> ecnCe) {
+    setDscp = dscp;
+    setEcnCe = ecnCe;
+}
+
+/**
+ * @brief Limits the rate at which packets are admitted to the class.
+ *
+ * Packets arriving while the bucket holds fewer tokens than their size exceed the
+ * profile; they are dropped, or remarked with the given DSCP and queued anyway. A zero
+ * rate removes the policer.
+ *
+ * @param rate Committed rate.
+ * @param burst Committed burst size, in bytes.
+ * @param action What to do with packets that exceed the profile.
+ * @param dscp DSCP given to exceeding packets when action is REMARK.
+ */
+void TrafficClass::SetPolicer(DataRate rate, uint32_t burst, PolicerAction action, uint8_t dscp) {
+    policer.Configure(rate, burst);
+    policerAction = action;
+    remarkDscp = dscp;
+    NS_LOG_INFO("Set policer rate=" << rate.GetBitRate() << "bps, burst=" << burst
+                << ", action=" << (action == DROP ? "drop" : "remark"));
+}
+
+/**
+ * @brief Limits the rate at which packets leave the class.
+ *
+ * The head packet is only eligible for scheduling once the bucket holds enough tokens
+ * for it; see GetEligibleTime(). A zero rate removes the shaper.
+ *
+ * @param rate Shaping rate.
+ * @param burst Burst size, in bytes.
+ */
+void TrafficClass::SetShaper(DataRate rate, uint32_t burst) {
+    shaper.Configure(rate, burst);
+    NS_LOG_INFO("Set shaper rate=" << rate.GetBitRate() << "bps, burst=" << burst);
+}
+
+bool TrafficClass::IsShaped() const {
+    return shaper.IsEnabled();
+}
+
+/**
+ * @brief Returns when the head packet conforms to the shaper.
+ *
+ * @return The current time if the class is empty, not shaped or its head packet conforms.
+ */
+Time TrafficClass::GetEligibleTime() {
+    Time now = Simulator::Now();
+    if (m_queue.IsEmpty()) {
+        return now;
+    }
+    return shaper.GetConformTime(m_queue.Front().descriptor.size, now);
+}
+
+/**
+ * @brief Installs an active queue management policy, replacing the current one.
+ *
+ * @param aqm The policy, e.g. from CreateAqm(); the class takes ownership. nullptr
+ *            restores plain tail drop.
+ */
+void TrafficClass::SetAqm(Aqm* aqm) {
+    delete this->aqm;
+    this->aqm = aqm;
+    NS_LOG_INFO("Set AQM=" << (aqm ? aqm->GetName() : "none")
+                << (aqm && aqm->GetEcn() ? " with ECN" : ""));
+}
+
+Aqm* TrafficClass::GetAqm() const {
+    return aqm;
+}
+
+uint64_t TrafficClass::GetAqmDrops() const {
+    return aqmDrops;
+}
+
+uint64_t TrafficClass::GetAqmMarks() const {
+    return aqmMarks;
+}
+
+/**
+ * @brief Returns the average time dequeued packets spent in the queue.
+ */
+Time TrafficClass::GetMeanSojournTime() const {
+    return NanoSeconds(static_cast<int64_t>(sojournHistogram.GetMean()));
+}
+
+Time TrafficClass::GetMaxSojournTime() const {
+    return NanoSeconds(sojournHistogram.GetMax());
+}
+
+/**
+ * @brief Returns the distribution of sojourn times of dequeued packets, in nanoseconds.
+ */
+const LogHistogram& TrafficClass::GetSojournHistogram() const {
+    return sojournHistogram;
+}
+
+/**
+ * @brief Returns the time-weighted distribution of the queue length in packets, up to now.
+ */
+const LogHistogram& TrafficClass::GetPacketOccupancyHistogram() {
+    UpdateOccupancy(Simulator::Now());
+    return packetHistogram;
+}
+
+/**
+ * @brief Returns the time-weighted distribution of the queue length in bytes, up to now.
+ */
+const LogHistogram& TrafficClass::GetByteOccupancyHistogram() {
+    UpdateOccupancy(Simulator::Now());
+    return byteHistogram;
+}
+
+/**
+ * @brief Clears the histograms and the AQM drop and mark counters.
+ */
+void TrafficClass::ResetStats() {
+    sojournHistogram.Reset();
+    packetHistogram.Reset();
+    byteHistogram.Reset();
+    lastOccupancyChange = Simulator::Now();
+    aqmDrops = 0;
+    aqmMarks = 0;
+}
+
+/**
+ * @brief Credits the current queue length with the time it was held since the last change.
+ *
+ * Called before every change of the queue length.
+ */
+void TrafficClass::UpdateOccupancy(Time now) {
+    uint64_t held = (now - lastOccupancyChange).GetNanoSeconds();
+    packetHistogram.Record(packets, held);
+    byteHistogram.Record(bytes, held);
+    lastOccupancyChange = now;
+}
+
+/**
+ * @brief Applies an AQM verdict to a packet.
+ *
+ * A MARK verdict on a packet that is not ECN-capable becomes a drop.
+ *
+ * @return True if the packet stays in the queue, possibly marked; false if it is dropped.
+ */
+bool TrafficClass::Signal(Aqm::Verdict verdict, Ptr<Packet> p) {
+    if (verdict == Aqm::MARK && setEcnCe(p)) {
+        aqmMarks++;
+        return true;
+    }
+    if (verdict != Aqm::ACCEPT) {
+        aqmDrops++;
+        return false;
+    }
+    return true;
 }
 
 } // namespace ns3
@@ -3,28 +3,59 @@
 
 #include "ns3/object.h"
 #include "ns3/packet.h"
+#include "ns3/callback.h"
+#include "ns3/traced-value.h"
+#include "ns3/traced-callback.h"
 #include "filter.h"
-#include <queue>
+#include "token-bucket.h"
+#include "aqm.h"
+#include "ring-buffer.h"
+#include "log-histogram.h"
+#include "ns3/data-rate.h"
+#include "ns3/nstime.h"
 #include <vector>
 
 namespace ns3 {
 
+/**
+ * @brief Metadata a TrafficClass keeps next to each queued packet, so schedulers and AQM
+ * policies do not go back to the Packet.
+ */
+struct PacketDescriptor {
+    uint32_t size = 0;          // bytes, as queued
+    uint32_t flowHash = 0;      // FlowKey::Hash() of the packet's headers, 0 if unknown
+    uint32_t classIndex = 0;    // index of the class in its DiffServ queue
+    Time arrival;               // enqueue time
+};
+
 class TrafficClass : public Object {
 public:
+    enum PolicerAction {
+        DROP,
+        REMARK
+    };
+
     TrafficClass();
     ~TrafficClass() override;
 
     static TypeId GetTypeId(void);
 
-    bool match(Ptr<Packet> p);
+    bool match(const FlowKey& key);
     bool Enqueue(Ptr<Packet> p);
-    Ptr<Packet> Dequeue();
-    Ptr<Packet> Remove();
+    bool Enqueue(Ptr<Packet> p, PacketDescriptor descriptor);
+    bool Admit(Ptr<Packet> p, uint32_t size);
+    void Push(Ptr<Packet> p, PacketDescriptor descriptor);
+    bool Adopt(Ptr<Packet> p, const PacketDescriptor& descriptor);
+    Ptr<Packet> Dequeue(PacketDescriptor* descriptor = nullptr);
+    Ptr<Packet> Remove(PacketDescriptor* descriptor = nullptr);
     Ptr<const Packet> Peek();
+    const PacketDescriptor* PeekDescriptor() const;
     bool IsEmpty();
 
     void SetMaxPackets(uint32_t mp);
     uint32_t GetMaxPackets();
+    uint32_t GetNPackets() const;
+    uint64_t GetNBytes() const;
     void SetWeight(uint32_t w);
     uint32_t GetWeight();
     void SetPriorityLevel(uint32_t pl);
@@ -32,15 +63,60 @@ public:
     void SetDefault(bool d);
     bool GetDefault();
     void AddFilter(Filter* f);
+    const std::vector<Filter*>& GetFilters() const;
+    void SetFiltersChangedCallback(Callback<void> cb);
+    void SetDropCallback(Callback<void, Ptr<Packet>, const PacketDescriptor&> cb);
+    void SetMarkCallbacks(Callback<bool, Ptr<Packet>, uint8_t> dscp, Callback<bool, Ptr<Packet>> ecnCe);
+
+    void SetPolicer(DataRate rate, uint32_t burst, PolicerAction action = DROP, uint8_t dscp = 0);
+    void SetShaper(DataRate rate, uint32_t burst);
+    bool IsShaped() const;
+    Time GetEligibleTime();
+
+    void SetAqm(Aqm* aqm);
+    Aqm* GetAqm() const;
+    uint64_t GetAqmDrops() const;
+    uint64_t GetAqmMarks() const;
+    Time GetMeanSojournTime() const;
+    Time GetMaxSojournTime() const;
+    const LogHistogram& GetSojournHistogram() const;
+    const LogHistogram& GetPacketOccupancyHistogram();
+    const LogHistogram& GetByteOccupancyHistogram();
+    void ResetStats();
 
 private:
-    std::queue<Ptr<Packet>> m_queue;
-    uint32_t packets;
+    struct Item {
+        Ptr<Packet> packet;
+        PacketDescriptor descriptor;
+    };
+
+    bool Signal(Aqm::Verdict verdict, Ptr<Packet> p);
+    void UpdateOccupancy(Time now);
+
+    RingBuffer<Item> m_queue;
+    TracedValue<uint32_t> packets;
+    TracedValue<uint64_t> bytes;
     uint32_t maxPackets;
     uint32_t weight;
     uint32_t priority_level;
     bool isDefault;
     std::vector<Filter*> filters;
+    Callback<void> filtersChanged;
+    Callback<void, Ptr<Packet>, const PacketDescriptor&> dropped;
+    Callback<bool, Ptr<Packet>, uint8_t> setDscp;
+    Callback<bool, Ptr<Packet>> setEcnCe;
+    TokenBucket policer;
+    PolicerAction policerAction;
+    uint8_t remarkDscp;
+    TokenBucket shaper;
+    Aqm* aqm;
+    uint64_t aqmDrops;
+    uint64_t aqmMarks;
+    TracedCallback<Time> sojournTrace;
+    LogHistogram sojournHistogram;      // nanoseconds, one sample per dequeued packet
+    LogHistogram packetHistogram;       // packets, weighted by nanoseconds held
+    LogHistogram byteHistogram;         // bytes, weighted by nanoseconds held
+    Time lastOccupancyChange;
 };
 
 } // namespace ns3